@@ -13,7 +13,8 @@ Modifications:
 ******************************************************************************/
 
 #include "AvlTree.h"
-#include <iostream.h>
+#include <iostream>
+#include <algorithm>
 
 
 /**
@@ -23,14 +24,14 @@ Modifications:
  */
 
 template<class Comparable>
-AvlTree<Comparable>::AvlTree() {}
+AvlTree<Comparable>::AvlTree() : root( NULL ), bulk( false ), unsettled( false ) {}
 
 /**
  * Construct the tree.
  */
 template <class Comparable>
 AvlTree<Comparable>::AvlTree( const Comparable & notFound ) :
-    ITEM_NOT_FOUND( notFound ), root( NULL )
+    root( NULL ), ITEM_NOT_FOUND( notFound ), bulk( false ), unsettled( false )
 {
 }
 
@@ -39,7 +40,7 @@ AvlTree<Comparable>::AvlTree( const Comparable & notFound ) :
  */
 template <class Comparable>
 AvlTree<Comparable>::AvlTree( const AvlTree<Comparable> & rhs ) :
-    ITEM_NOT_FOUND( rhs.ITEM_NOT_FOUND ), root( NULL )
+    root( NULL ), ITEM_NOT_FOUND( rhs.ITEM_NOT_FOUND ), bulk( false ), unsettled( false )
 {
     *this = rhs;
 }
@@ -59,7 +60,13 @@ AvlTree<Comparable>::~AvlTree( )
 template <class Comparable>
 void AvlTree<Comparable>::insert( const Comparable & x )
 {
-    insert( x, root );
+    if( bulk )
+    {
+        staged.push_back( x );
+        unsettled.store( true, std::memory_order_relaxed );
+    }
+    else
+        insert( x, root );
 }
 
 /**
@@ -68,6 +75,7 @@ void AvlTree<Comparable>::insert( const Comparable & x )
 template <class Comparable>
 void AvlTree<Comparable>::remove( const Comparable & x )
 {
+    settle( );
     remove(x, root);
 }
 
@@ -78,6 +86,7 @@ void AvlTree<Comparable>::remove( const Comparable & x )
 template <class Comparable>
 const Comparable & AvlTree<Comparable>::findMin( ) const
 {
+    settle( );
     return elementAt( findMin( root ) );
 }
 
@@ -88,6 +97,7 @@ const Comparable & AvlTree<Comparable>::findMin( ) const
 template <class Comparable>
 const Comparable & AvlTree<Comparable>::findMax( ) const
 {
+    settle( );
     return elementAt( findMax( root ) );
 }
 
@@ -99,6 +109,7 @@ template <class Comparable>
 const Comparable & AvlTree<Comparable>::
                             find( const Comparable & x ) const
 {
+    settle( );
     return elementAt( find( x, root ) );
 }
 
@@ -109,6 +120,8 @@ template <class Comparable>
 void AvlTree<Comparable>::makeEmpty( )
 {
     makeEmpty( root );
+    staged.clear( );
+    unsettled.store( false, std::memory_order_relaxed );
 }
 
 /**
@@ -118,6 +131,7 @@ void AvlTree<Comparable>::makeEmpty( )
 template <class Comparable>
 bool AvlTree<Comparable>::isEmpty( ) const
 {
+    settle( );
     return root == NULL;
 }
 
@@ -127,12 +141,76 @@ bool AvlTree<Comparable>::isEmpty( ) const
 template <class Comparable>
 void AvlTree<Comparable>::printTree( ) const
 {
+    settle( );
     if( isEmpty( ) )
-        cout << "Empty tree" << endl;
+        std::cout << "Empty tree" << std::endl;
     else
         printTree( root );
 }
 
+/**
+ * Call visit on every item in sorted order.
+ */
+template <class Comparable>
+template <class Visit>
+void AvlTree<Comparable>::for_each( Visit visit ) const
+{
+    settle( );
+    for_each( root, visit );
+}
+
+/**
+ * Call visit on every item, spread over the threads of pool.
+ * Items are visited in no set order and from several threads at once,
+ * so visit must be safe to call concurrently.
+ */
+template <class Comparable>
+template <class Visit>
+void AvlTree<Comparable>::parallel_for_each( Visit visit, ThreadPool & pool ) const
+{
+    std::vector<std::pair<AvlNode<Comparable> *, bool> > pieces;
+    cut( pool, pieces );
+    pool.run( pieces.size( ), [&]( int i )
+    {
+        if( pieces[ i ].second )
+            for_each( pieces[ i ].first, visit );
+        else
+            visit( pieces[ i ].first->element );
+    } );
+}
+
+/**
+ * Return identity combined with map( x ) for every item x, that is
+ * combine( ... combine( identity, map( x1 ) ) ..., map( xn ) ).
+ * Each thread folds whole subtrees; their results are then combined in
+ * sorted order, so combine need be associative but not commutative.
+ */
+template <class Comparable>
+template <class T, class Map, class Combine>
+T AvlTree<Comparable>::parallel_reduce( const T & identity, Map map, Combine combine,
+                                        ThreadPool & pool ) const
+{
+    std::vector<std::pair<AvlNode<Comparable> *, bool> > pieces;
+    cut( pool, pieces );
+    std::vector<T> results( pieces.size( ), identity );
+    pool.run( pieces.size( ), [&]( int i )
+    {
+        T result = identity;
+        if( pieces[ i ].second )
+        {
+            auto fold = [&]( const Comparable & x ) { result = combine( result, map( x ) ); };
+            for_each( pieces[ i ].first, fold );
+        }
+        else
+            result = combine( result, map( pieces[ i ].first->element ) );
+        results[ i ] = result;
+    } );
+    T total = identity;
+    for( size_t i = 0; i < results.size( ); i++ )
+        total = combine( total, results[ i ] );
+    return total;
+}
+
 /**
  * Deep copy.
  */
@@ -144,11 +222,164 @@ operator=( const AvlTree<Comparable> & rhs )
     if( this != &rhs )
     {
         makeEmpty( );
+        rhs.settle( );
         root = clone( rhs.root );
     }
     return *this;
 }
 
+/**
+ * Start staging inserts: until end_bulk, insert only appends x to an
+ * unsorted buffer, and the buffer is placed in the tree all at once by
+ * the next query, removal or end_bulk. Meant for loads that are not
+ * queried until they finish, which then skip every rotation.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::begin_bulk( )
+{
+    bulk = true;
+}
+
+/**
+ * Place the staged items and go back to inserting one at a time.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::end_bulk( )
+{
+    settle( );
+    bulk = false;
+}
+
+/**
+ * Move every item of rhs into this tree, leaving rhs empty. An item of
+ * rhs that is already in this tree is dropped. Both trees are flattened,
+ * merged in one linear pass and relinked balanced, reusing the nodes of
+ * both, so no item is copied.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::merge( AvlTree<Comparable> & rhs )
+{
+    if( this == &rhs )
+        return;
+    rhs.settle( );
+    std::vector<AvlNode<Comparable> *> nodes;
+    flatten( rhs.root, nodes );
+    rhs.root = NULL;
+    settle( );
+    unite( nodes );
+}
+
+/**
+ * Move every item not less than x into rhs, replacing what rhs held.
+ * Takes O( log n ) time: the tree is cut along the search path for x and
+ * the pieces on either side are joined back together.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::split( const Comparable & x, AvlTree<Comparable> & rhs )
+{
+    if( this == &rhs )
+        return;
+    settle( );
+    rhs.makeEmpty( );
+    AvlNode<Comparable> *less, *rest;
+    split( root, x, less, rest );
+    root = less;
+    rhs.root = rest;
+}
+
+/**
+ * Move every item of rhs to this tree, leaving rhs empty. Every item of
+ * rhs must be greater than every item of this tree. Takes O( log n ) time.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::join( AvlTree<Comparable> & rhs )
+{
+    if( this == &rhs )
+        return;
+    settle( );
+    rhs.settle( );
+    root = join( root, rhs.root );
+    rhs.root = NULL;
+}
+
+/**
+ * Move every item x with lo <= x < hi into rhs, replacing what rhs held.
+ * Takes O( log n ) time, with two splits and a join.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::extract( const Comparable & lo, const Comparable & hi,
+                                   AvlTree<Comparable> & rhs )
+{
+    if( this == &rhs )
+        return;
+    AvlTree<Comparable> upper( ITEM_NOT_FOUND );
+    split( lo, rhs );
+    rhs.split( hi, upper );
+    join( upper );
+}
+
+/**
+ * Internal method to place the staged items in the tree.
+ * They are sorted and then united with the tree; as with insert, an item
+ * already in the tree, or staged earlier, wins over a duplicate staged
+ * later. Of several const queries that call this at once, one places the
+ * items under settling and the others wait for it; once unsettled is
+ * clear, every caller sees the tree it built.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::settle( ) const
+{
+    if( !unsettled.load( std::memory_order_acquire ) )
+        return;
+    std::lock_guard<std::mutex> lock( settling );
+    if( !unsettled.load( std::memory_order_relaxed ) )
+        return;
+    std::stable_sort( staged.begin( ), staged.end( ) );
+    typename std::vector<Comparable>::iterator last =
+        std::unique( staged.begin( ), staged.end( ),
+                     []( const Comparable & a, const Comparable & b ) { return !( a < b ) && !( b < a ); } );
+
+    std::vector<AvlNode<Comparable> *> nodes;
+    nodes.reserve( last - staged.begin( ) );
+    for( typename std::vector<Comparable>::iterator it = staged.begin( ); it != last; ++it )
+        nodes.push_back( new AvlNode<Comparable>( *it, NULL, NULL ) );
+    staged.clear( );
+    unite( nodes );
+    unsettled.store( false, std::memory_order_release );
+}
+
+/**
+ * Internal method to merge nodes, which are sorted and free of
+ * duplicates, with the nodes of the tree in one linear pass, and relink
+ * them all into a perfectly balanced tree. A node whose item is already
+ * in the tree is freed.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::unite( std::vector<AvlNode<Comparable> *> & nodes ) const
+{
+    if( nodes.empty( ) )
+        return;
+    std::vector<AvlNode<Comparable> *> mine;
+    flatten( root, mine );
+    std::vector<AvlNode<Comparable> *> merged;
+    merged.reserve( mine.size( ) + nodes.size( ) );
+    size_t a = 0, b = 0;
+    while( a < mine.size( ) && b < nodes.size( ) )
+    {
+        if( nodes[ b ]->element < mine[ a ]->element )
+            merged.push_back( nodes[ b++ ] );
+        else
+        {
+            if( !( mine[ a ]->element < nodes[ b ]->element ) )
+                delete nodes[ b++ ];      // Duplicate; keep the one in the tree
+            merged.push_back( mine[ a++ ] );
+        }
+    }
+    merged.insert( merged.end( ), mine.begin( ) + a, mine.end( ) );
+    merged.insert( merged.end( ), nodes.begin( ) + b, nodes.end( ) );
+    root = link( merged, 0, merged.size( ) );
+}
+
 /**
  * Internal method to get element field in node t.
  * Return the element field or ITEM_NOT_FOUND if t is NULL.
@@ -163,87 +394,93 @@ const Comparable & AvlTree<Comparable>::elementAt( AvlNode<Comparable> *t ) cons
  * Internal method to insert into a subtree.
  * x is the item to insert.
  * t is the node that roots the tree.
+ * The links followed on the way down are kept in path; on the way back
+ * up each node is rebalanced, stopping at the first whose height did not
+ * change, since nothing above it can have changed either.
  */
 template <class Comparable>
 void AvlTree<Comparable>::insert( const Comparable & x, AvlNode<Comparable> * & t ) const
 {
-    if( t == NULL )
-        t = new AvlNode<Comparable>( x, NULL, NULL );
-    else if( x < t->element )
+    AvlNode<Comparable> **path[ MAX_HEIGHT ];
+    int depth = 0;
+    AvlNode<Comparable> **link = &t;
+    while( *link != NULL )
     {
-        insert( x, t->left );
-        if( height( t->left ) - height( t->right ) == 2 )
-            if( x < t->left->element )
-                rotateWithLeftChild( t );
-            else
-                doubleWithLeftChild( t );
+        path[ depth++ ] = link;
+        if( x < ( *link )->element )
+            link = &( *link )->left;
+        else if( ( *link )->element < x )
+            link = &( *link )->right;
+        else
+            return;  // Duplicate; do nothing
     }
-    else if( t->element < x )
+    *link = new AvlNode<Comparable>( x, NULL, NULL );
+    while( depth > 0 )
     {
-        insert( x, t->right );
-        if( height( t->right ) - height( t->left ) == 2 )
-            if( t->right->element < x )
-                rotateWithRightChild( t );
-            else
-                doubleWithRightChild( t );
+        AvlNode<Comparable> * & n = *path[ --depth ];
+        int oldHeight = n->height;
+        rebalance( n );
+        if( n->height == oldHeight )
+            break;
     }
-    else
-        ;  // Duplicate; do nothing
-    t->height = max( height( t->left ), height( t->right ) ) + 1;
 }
 
-
 /**
- * Internal method to insert into a subtree.
+ * Internal method to remove from a subtree.
  * x is the item to remove.
  * t is the node that roots the tree.
+ * A node with two children is replaced by the node of the smallest item
+ * of its right subtree, relinked in its place rather than copied, so an
+ * item keeps its node, and its address, while it is in the tree. The
+ * links followed on the way down are kept in path and rebalanced on the
+ * way back up, stopping at the first node whose height did not change.
  */
 template <class Comparable>
-void AvlTree<Comparable>::remove( const Comparable & x, AvlNode<Comparable> * & t ) const{
-    if(t == NULL)   // can't delete from an empty tree
+void AvlTree<Comparable>::remove( const Comparable & x, AvlNode<Comparable> * & t ) const
+{
+    AvlNode<Comparable> **path[ MAX_HEIGHT ];
+    int depth = 0;
+    AvlNode<Comparable> **link = &t;
+    while( *link != NULL && ( x < ( *link )->element || ( *link )->element < x ) )
+    {
+        path[ depth++ ] = link;
+        link = x < ( *link )->element ? &( *link )->left : &( *link )->right;
+    }
+    if( *link == NULL )   // not found
         return;
-    if(x < t->element) {    //delete from left subtree
-        remove(x, t->left);
-        //check if the heights of the subtrees are now too different
-        if(height(t->right) - height(t->left) ==2){ //unbalanced
-           if(height((t->right)->right) >= height((t->right) ->left))
-               rotateWithLeftChild(t);
-           else
-               doubleWithLeftChild(t);
-        }
 
-    }
-    else if(t->element < x) {   //delete from the right subtree
-        remove(x, t->right);
-        if ( height ( t - > left ) - height ( t - > right ) == 2 ) { // unbalanced
-            //left subtree too tall
-            if ( height (( t - > left ) -> left ) >= height (( t - > left ) -> right ))
-                rotateWithRightChild (t) ;
-            else
-                doubleWithRightChild (t) ;
+    AvlNode<Comparable> *target = *link;
+    if( target->left != NULL && target->right != NULL )   // two non-empty subtrees
+    {
+        int targetDepth = depth;
+        path[ depth++ ] = link;
+        AvlNode<Comparable> **next = &target->right;
+        while( ( *next )->left != NULL )
+        {
+            path[ depth++ ] = next;
+            next = &( *next )->left;
         }
+        AvlNode<Comparable> *successor = *next;
+        *next = successor->right;
+        successor->left = target->left;
+        successor->right = target->right;
+        successor->height = target->height;
+        *link = successor;
+        if( depth > targetDepth + 1 )   // the walk went through target->right
+            path[ targetDepth + 1 ] = &successor->right;
     }
-    else {  // delete this node
-        if (( t - > left != NULL ) && (t - > right != NULL )) { //two non-empty subtrees
-            t->element = findMin(t->right) -> element;
-            remove(t->element, t->right);
-            if(height(t->left) - height(t->right) == 2){    //unbalanced
-                //left subtree too tall
-                if ( height (( t - > left ) -> left ) >= height (( t - > left ) -> right ) )
-                    rotateWithRightChild (t) ;
-                else
-                    doubleWithRightChild (t) ;
-            }
+    else
+        *link = ( target->left != NULL ) ? target->left : target->right;
+    delete target;
 
-        }
-        else {
-            AvlNode<Comparable> *OldNode = t;
-            t = (t->left != NULL) ? t->left: t->right;
-            delete OldNode;
-        }
+    while( depth > 0 )
+    {
+        AvlNode<Comparable> * & n = *path[ --depth ];
+        int oldHeight = n->height;
+        rebalance( n );
+        if( n->height == oldHeight )
+            break;
     }
-    if (NULL != t)
-        t - > height = max ( height ( t - > left ) , height ( t - > right ) ) + 1;
 }
 
 /**
@@ -301,31 +538,216 @@ AvlTree<Comparable>::find( const Comparable & x, AvlNode<Comparable> *t ) const
 
 /**
  * Internal method to make subtree empty.
+ * A node with a left child is rotated right until it has none, and is
+ * then freed and its right subtree taken next, so no stack is needed.
  */
 template <class Comparable>
 void AvlTree<Comparable>::makeEmpty( AvlNode<Comparable> * & t ) const
 {
-    if( t != NULL )
+    while( t != NULL )
     {
-        makeEmpty( t->left );
-        makeEmpty( t->right );
-        delete t;
+        AvlNode<Comparable> *n = t;
+        if( n->left != NULL )
+        {
+            t = n->left;
+            n->left = t->right;
+            t->right = n;
+        }
+        else
+        {
+            t = n->right;
+            delete n;
+        }
     }
-    t = NULL;
 }
 
 /**
- * Internal method to clone subtree.
+ * Internal method to cut the subtree rooted at t into pieces, in sorted
+ * order: every subtree of height grain or less is one whole piece, and
+ * every node above them is a piece on its own.
  */
 template <class Comparable>
-AvlNode<Comparable> *
-AvlTree<Comparable>::clone( AvlNode<Comparable> * t ) const
+void AvlTree<Comparable>::cut( AvlNode<Comparable> *t, int grain,
+                               std::vector<std::pair<AvlNode<Comparable> *, bool> > & pieces ) const
 {
     if( t == NULL )
+        return;
+    if( t->height <= grain )
+    {
+        pieces.push_back( std::make_pair( t, true ) );
+        return;
+    }
+    cut( t->left, grain, pieces );
+    pieces.push_back( std::make_pair( t, false ) );
+    cut( t->right, grain, pieces );
+}
+
+/**
+ * Internal method to cut the tree into about PIECES_PER_THREAD whole
+ * subtrees for each thread of pool.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::cut( ThreadPool & pool,
+                               std::vector<std::pair<AvlNode<Comparable> *, bool> > & pieces ) const
+{
+    settle( );
+    int levels = 0;
+    while( ( 1 << levels ) < PIECES_PER_THREAD * pool.size( ) )
+        levels++;
+    cut( root, height( root ) - levels, pieces );
+}
+
+/**
+ * Internal method to append the nodes of subtree t to nodes, in sorted
+ * order. The nodes are left for the caller to relink or free.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::flatten( AvlNode<Comparable> *t,
+                                   std::vector<AvlNode<Comparable> *> & nodes ) const
+{
+    if( t == NULL )
+        return;
+    flatten( t->left, nodes );
+    nodes.push_back( t );
+    flatten( t->right, nodes );
+}
+
+/**
+ * Internal method to link nodes[ lo ] up to but not including
+ * nodes[ hi ], which are in sorted order, into a perfectly balanced
+ * subtree. Return the root of the subtree.
+ */
+template <class Comparable>
+AvlNode<Comparable> *
+AvlTree<Comparable>::link( std::vector<AvlNode<Comparable> *> & nodes, int lo, int hi ) const
+{
+    if( lo >= hi )
         return NULL;
+    int mid = lo + ( hi - lo ) / 2;
+    AvlNode<Comparable> *t = nodes[ mid ];
+    t->left = link( nodes, lo, mid );
+    t->right = link( nodes, mid + 1, hi );
+    t->height = max( height( t->left ), height( t->right ) ) + 1;
+    return t;
+}
+
+/**
+ * Internal method to split subtree t into less, the items less than x,
+ * and rest, the others. The nodes of t are reused.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::split( AvlNode<Comparable> *t, const Comparable & x,
+                                 AvlNode<Comparable> * & less, AvlNode<Comparable> * & rest ) const
+{
+    if( t == NULL )
+    {
+        less = rest = NULL;
+        return;
+    }
+    AvlNode<Comparable> *l = t->left, *r = t->right;
+    if( t->element < x )
+    {
+        split( r, x, less, rest );
+        less = join( l, t, less );
+    }
     else
-        return new AvlNode<Comparable>( t->element, clone( t->left ),
-                                        clone( t->right ), t->height );
+    {
+        split( l, x, less, rest );
+        rest = join( rest, t, r );
+    }
+}
+
+/**
+ * Internal method to join l, node k and r, whose items are in that order,
+ * into one subtree. k is hung where the shorter of l and r meets the
+ * spine of the taller, and the rotations on the way back up restore the
+ * balance, in O( 1 + | height( l ) - height( r ) | ) time.
+ * Return the root of the joined subtree.
+ */
+template <class Comparable>
+AvlNode<Comparable> *
+AvlTree<Comparable>::join( AvlNode<Comparable> *l, AvlNode<Comparable> *k,
+                           AvlNode<Comparable> *r ) const
+{
+    if( height( l ) > height( r ) + 1 )
+    {
+        l->right = join( l->right, k, r );
+        rebalance( l );
+        return l;
+    }
+    if( height( r ) > height( l ) + 1 )
+    {
+        r->left = join( l, k, r->left );
+        rebalance( r );
+        return r;
+    }
+    k->left = l;
+    k->right = r;
+    k->height = max( height( l ), height( r ) ) + 1;
+    return k;
+}
+
+/**
+ * Internal method to join l and r, whose items are in that order, using
+ * the smallest node of r to hang them from.
+ * Return the root of the joined subtree.
+ */
+template <class Comparable>
+AvlNode<Comparable> *
+AvlTree<Comparable>::join( AvlNode<Comparable> *l, AvlNode<Comparable> *r ) const
+{
+    if( r == NULL )
+        return l;
+    AvlNode<Comparable> *k = detachMin( r );
+    return join( l, k, r );
+}
+
+/**
+ * Internal method to unlink the smallest node of non-empty subtree t,
+ * rebalancing on the way back up.
+ * Return the unlinked node.
+ */
+template <class Comparable>
+AvlNode<Comparable> *
+AvlTree<Comparable>::detachMin( AvlNode<Comparable> * & t ) const
+{
+    if( t->left == NULL )
+    {
+        AvlNode<Comparable> *min = t;
+        t = t->right;
+        min->right = NULL;
+        return min;
+    }
+    AvlNode<Comparable> *min = detachMin( t->left );
+    rebalance( t );
+    return min;
+}
+
+/**
+ * Internal method to clone subtree.
+ */
+template <class Comparable>
+AvlNode<Comparable> *
+AvlTree<Comparable>::clone( AvlNode<Comparable> * t ) const
+{
+    AvlNode<Comparable> *copy = NULL;
+    std::pair<AvlNode<Comparable> *, AvlNode<Comparable> **> pending[ MAX_HEIGHT ];
+    int top = 0;                // right subtrees still to copy, and where
+    if( t != NULL )
+        pending[ top++ ] = std::make_pair( t, &copy );
+    while( top > 0 )
+    {
+        AvlNode<Comparable> *from = pending[ --top ].first;
+        AvlNode<Comparable> **to = pending[ top ].second;
+        for( ; from != NULL; from = from->left )
+        {
+            *to = new AvlNode<Comparable>( from->element, NULL, NULL, from->height );
+            if( from->right != NULL )
+                pending[ top++ ] = std::make_pair( from->right, &( *to )->right );
+            to = &( *to )->left;
+        }
+    }
+    return copy;
 }
 
 /**
@@ -404,6 +826,31 @@ void AvlTree<Comparable>::doubleWithRightChild( AvlNode<Comparable> * & k1 ) con
     rotateWithRightChild( k1 );
 }
 
+/**
+ * Restore the balance of node t, whose subtrees are balanced and differ
+ * in height by at most two, and update its height.
+ */
+template <class Comparable>
+void AvlTree<Comparable>::rebalance( AvlNode<Comparable> * & t ) const
+{
+    if( height( t->left ) - height( t->right ) == 2 )
+    {
+        if( height( t->left->left ) >= height( t->left->right ) )
+            rotateWithLeftChild( t );
+        else
+            doubleWithLeftChild( t );
+    }
+    else if( height( t->right ) - height( t->left ) == 2 )
+    {
+        if( height( t->right->right ) >= height( t->right->left ) )
+            rotateWithRightChild( t );
+        else
+            doubleWithRightChild( t );
+    }
+    else
+        t->height = max( height( t->left ), height( t->right ) ) + 1;
+}
+
 /**
  * Internal method to print a subtree in sorted order.
  * t points to the node that roots the tree.
@@ -411,10 +858,26 @@ void AvlTree<Comparable>::doubleWithRightChild( AvlNode<Comparable> * & k1 ) con
 template <class Comparable>
 void AvlTree<Comparable>::printTree( AvlNode<Comparable> *t ) const
 {
-    if( t != NULL )
+    auto print = []( const Comparable & x ) { std::cout << x << std::endl; };
+    for_each( t, print );
+}
+
+/**
+ * Internal method to visit a subtree in sorted order.
+ * t points to the node that roots the tree.
+ */
+template <class Comparable>
+template <class Visit>
+void AvlTree<Comparable>::for_each( AvlNode<Comparable> *t, Visit & visit ) const
+{
+    AvlNode<Comparable> *ancestors[ MAX_HEIGHT ];   // passed on the left, not yet visited
+    int top = 0;
+    while( t != NULL || top > 0 )
     {
-        printTree( t->left );
-        cout << t->element << endl;
-        printTree( t->right );
+        for( ; t != NULL; t = t->left )
+            ancestors[ top++ ] = t;
+        t = ancestors[ --top ];
+        visit( t->element );
+        t = t->right;
     }
-}
\ No newline at end of file
+}
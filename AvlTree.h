@@ -20,7 +20,12 @@ public:
 
 
 #include "dsexceptions.h"
-#include <iostream.h>       // For NULL
+#include "thread_pool.h"
+#include <cstddef>          // For NULL
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <vector>
 
 // AvlTree class
 //
@@ -28,13 +33,28 @@ public:
 //
 // ******************PUBLIC OPERATIONS*********************
 // void insert( x )       --> Insert x
-// void remove( x )       --> Remove x (unimplemented)
+// void remove( x )       --> Remove x
 // Comparable find( x )   --> Return item that matches x
 // Comparable findMin( )  --> Return smallest item
 // Comparable findMax( )  --> Return largest item
 // boolean isEmpty( )     --> Return true if empty; else false
 // void makeEmpty( )      --> Remove all items
 // void printTree( )      --> Print tree in sorted order      
+// void for_each( f )     --> Call f on every item in sorted order
+// void parallel_for_each( f )      --> Call f on every item, in no set order,
+//                                      on the threads of a ThreadPool
+// T parallel_reduce( id, map, c )  --> Combine map( x ) of every item with c,
+//                                      in parallel
+// void begin_bulk( )     --> Stage inserts instead of placing them
+// void end_bulk( )       --> Place the staged items and stop staging
+// void merge( rhs )      --> Move every item of rhs into this tree
+// void split( x, rhs )   --> Move the items not less than x into rhs
+// void join( rhs )       --> Move the items of rhs, all greater, to the end
+// void extract( lo, hi, rhs ) --> Move the items in [lo, hi) into rhs
+//
+// An item stays at one address from the time it is placed until it is
+// removed: rotations, remove, merge, split, join and extract relink nodes
+// and never copy items between them.
 
   // Node and forward declaration because g++ does
   // not understand nested classes.
@@ -60,15 +80,51 @@ class AvlTree
     bool isEmpty( ) const;
     void printTree( ) const;
 
+    template <class Visit>
+    void for_each( Visit visit ) const;
+
+    // subtrees handed to each thread of the pool, for load balance
+    static const int PIECES_PER_THREAD = 8;
+
+    template <class Visit>
+    void parallel_for_each( Visit visit, ThreadPool & pool = ThreadPool::shared( ) ) const;
+    template <class T, class Map, class Combine>
+    T parallel_reduce( const T & identity, Map map, Combine combine,
+                       ThreadPool & pool = ThreadPool::shared( ) ) const;
+
     void makeEmpty( );
     void insert( const Comparable & x );
     void remove( const Comparable & x );
 
+    void begin_bulk( );
+    void end_bulk( );
+    void merge( AvlTree & rhs );
+    void split( const Comparable & x, AvlTree & rhs );
+    void join( AvlTree & rhs );
+    void extract( const Comparable & lo, const Comparable & hi, AvlTree & rhs );
+
     const AvlTree & operator=( const AvlTree & rhs );
 
   private:
-    AvlNode<Comparable> *root;
+    // nodes on the longest path from the root; an AVL tree 64 high would
+    // need more than 2^45 nodes
+    static const int MAX_HEIGHT = 64;
+
+    // A const query first places the staged items (see settle), so root
+    // and staged change under const methods. settle holds settling while it
+    // does, and clears unsettled only when done, so const queries are safe
+    // to run at once; none is safe alongside insert, remove or the like.
+    mutable AvlNode<Comparable> *root;
     const Comparable ITEM_NOT_FOUND;
+    bool bulk;                                  // true between begin_bulk and end_bulk
+    mutable std::vector<Comparable> staged;     // inserted since the last query, unsorted
+    mutable std::atomic<bool> unsettled;        // true while staged is not empty
+    mutable std::mutex settling;
+
+    void settle( ) const;
+    void unite( std::vector<AvlNode<Comparable> *> & nodes ) const;
+    void flatten( AvlNode<Comparable> *t, std::vector<AvlNode<Comparable> *> & nodes ) const;
+    AvlNode<Comparable> * link( std::vector<AvlNode<Comparable> *> & nodes, int lo, int hi ) const;
 
     const Comparable & elementAt( AvlNode<Comparable> *t ) const;
     void insert( const Comparable & x, AvlNode<Comparable> * & t ) const;
@@ -78,6 +134,18 @@ class AvlTree
     AvlNode<Comparable> * find( const Comparable & x, AvlNode<Comparable> *t ) const;
     void makeEmpty( AvlNode<Comparable> * & t ) const;
     void printTree( AvlNode<Comparable> *t ) const;
+    template <class Visit>
+    void for_each( AvlNode<Comparable> *t, Visit & visit ) const;
+    void cut( AvlNode<Comparable> *t, int grain,
+              std::vector<std::pair<AvlNode<Comparable> *, bool> > & pieces ) const;
+    void cut( ThreadPool & pool,
+              std::vector<std::pair<AvlNode<Comparable> *, bool> > & pieces ) const;
+    void split( AvlNode<Comparable> *t, const Comparable & x,
+                AvlNode<Comparable> * & less, AvlNode<Comparable> * & rest ) const;
+    AvlNode<Comparable> * join( AvlNode<Comparable> *l, AvlNode<Comparable> *k,
+                                AvlNode<Comparable> *r ) const;
+    AvlNode<Comparable> * join( AvlNode<Comparable> *l, AvlNode<Comparable> *r ) const;
+    AvlNode<Comparable> * detachMin( AvlNode<Comparable> * & t ) const;
     AvlNode<Comparable> * clone( AvlNode<Comparable> *t ) const;
 
         // Avl manipulations
@@ -87,6 +155,7 @@ class AvlTree
     void rotateWithRightChild( AvlNode<Comparable> * & k1 ) const;
     void doubleWithLeftChild( AvlNode<Comparable> * & k3 ) const;
     void doubleWithRightChild( AvlNode<Comparable> * & k1 ) const;
+    void rebalance( AvlNode<Comparable> * & t ) const;
 };
 
 #include "AvlTree.cpp"
@@ -0,0 +1,855 @@
+/******************************************************************************
+Title : BPlusTree.cpp
+Author : Yu Tong Chen
+Created on : 04/18/2019
+Description : The implementation of BPlusTree.h.
+Usage : Included by BPlusTree.h; do not compile separately.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "BPlusTree.h"
+#include <algorithm>
+
+
+/**
+ * Construct the tree.
+ */
+template <class Comparable>
+BPlusTree<Comparable>::BPlusTree( ) :
+    root( NULL ), head( NULL ), tail( NULL ), ITEM_NOT_FOUND( ), bulk( false ),
+    unsettled( false )
+{
+}
+
+/**
+ * Construct the tree.
+ */
+template <class Comparable>
+BPlusTree<Comparable>::BPlusTree( const Comparable & notFound ) :
+    root( NULL ), head( NULL ), tail( NULL ), ITEM_NOT_FOUND( notFound ), bulk( false ),
+    unsettled( false )
+{
+}
+
+/**
+ * Copy constructor.
+ */
+template <class Comparable>
+BPlusTree<Comparable>::BPlusTree( const BPlusTree<Comparable> & rhs ) :
+    root( NULL ), head( NULL ), tail( NULL ), ITEM_NOT_FOUND( rhs.ITEM_NOT_FOUND ), bulk( false ),
+    unsettled( false )
+{
+    *this = rhs;
+}
+
+/**
+ * Destructor for the tree.
+ */
+template <class Comparable>
+BPlusTree<Comparable>::~BPlusTree( )
+{
+    makeEmpty( );
+}
+
+/**
+ * Advance to the next item, following the leaf chain.
+ */
+template <class Comparable>
+typename BPlusTree<Comparable>::const_iterator &
+BPlusTree<Comparable>::const_iterator::operator++( )
+{
+    if( ++pos == leaf->count )
+    {
+        leaf = leaf->next;
+        pos = 0;
+    }
+    return *this;
+}
+
+/**
+ * Insert x into the tree; duplicates are ignored.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::insert( const Comparable & x )
+{
+    if( bulk )
+    {
+        staged.push_back( x );
+        unsettled.store( true, std::memory_order_relaxed );
+        return;
+    }
+    if( root == NULL )
+    {
+        Leaf *l = new Leaf( );
+        l->items[ 0 ] = new Comparable( x );
+        l->count = 1;
+        root = head = tail = l;
+        return;
+    }
+
+    const Comparable *upKey = NULL;
+    Node *upNode = NULL;
+    insert( x, root, upKey, upNode );
+    if( upNode != NULL )      // root split: grow the tree by one level
+    {
+        Inner *r = new Inner( );
+        r->keys[ 0 ] = upKey;
+        r->child[ 0 ] = root;
+        r->child[ 1 ] = upNode;
+        r->count = 1;
+        root = r;
+    }
+}
+
+/**
+ * Remove x from the tree. Nothing is done if x is not found.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::remove( const Comparable & x )
+{
+    settle( );
+    delete detach( x );
+}
+
+/**
+ * Internal method to take x out of the tree without freeing it.
+ * Any separator left pointing at x is then pointed at the item after x,
+ * which is as good a separator now that x is gone.
+ * Return the item that matched x, or NULL if x is not found.
+ */
+template <class Comparable>
+Comparable * BPlusTree<Comparable>::detach( const Comparable & x )
+{
+    const Leaf *l = findLeaf( x );
+    if( l == NULL )
+        return NULL;
+    int i = leafPosition( l, x );
+    if( i == l->count || x < *l->items[ i ] )
+        return NULL;
+    Comparable *item = l->items[ i ];
+    const Comparable *next = ( i + 1 < l->count ) ? l->items[ i + 1 ] :
+                             ( l->next != NULL ) ? l->next->items[ 0 ] : NULL;
+
+    remove( x, root );
+    if( root->leaf && root->count == 0 )
+    {
+        delete static_cast<Leaf *>( root );
+        root = head = tail = NULL;
+    }
+    else if( !root->leaf && root->count == 0 )   // shrink the tree by one level
+    {
+        Inner *old = static_cast<Inner *>( root );
+        root = old->child[ 0 ];
+        delete old;
+    }
+    unhook( x, item, next );
+    return item;
+}
+
+/**
+ * Internal method to point every separator on the path to x that points
+ * at old, the item that matched x, at next, the item that followed it.
+ * A separator at old lies on that path, and the subtree to its right is
+ * not empty, as every node but the root is at least half full, so next
+ * is the smallest item of that subtree.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::unhook( const Comparable & x, const Comparable *old,
+                                    const Comparable *next )
+{
+    for( Node *t = root; t != NULL && !t->leaf; )
+    {
+        Inner *n = static_cast<Inner *>( t );
+        int i = childPosition( n, x );
+        if( i > 0 && n->keys[ i - 1 ] == old )
+            n->keys[ i - 1 ] = next;
+        t = n->child[ i ];
+    }
+}
+
+/**
+ * Find the smallest item in the tree.
+ * Return smallest item or ITEM_NOT_FOUND if empty.
+ */
+template <class Comparable>
+const Comparable & BPlusTree<Comparable>::findMin( ) const
+{
+    settle( );
+    return head == NULL ? ITEM_NOT_FOUND : *head->items[ 0 ];
+}
+
+/**
+ * Find the largest item in the tree.
+ * Return the largest item of ITEM_NOT_FOUND if empty.
+ */
+template <class Comparable>
+const Comparable & BPlusTree<Comparable>::findMax( ) const
+{
+    settle( );
+    return tail == NULL ? ITEM_NOT_FOUND : *tail->items[ tail->count - 1 ];
+}
+
+/**
+ * Find item x in the tree.
+ * Return the matching item or ITEM_NOT_FOUND if not found.
+ */
+template <class Comparable>
+const Comparable & BPlusTree<Comparable>::find( const Comparable & x ) const
+{
+    settle( );
+    const Leaf *l = findLeaf( x );
+    if( l == NULL )
+        return ITEM_NOT_FOUND;
+    int i = leafPosition( l, x );
+    if( i < l->count && !( x < *l->items[ i ] ) )
+        return *l->items[ i ];
+    return ITEM_NOT_FOUND;
+}
+
+/**
+ * Make the tree logically empty.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::makeEmpty( )
+{
+    for( Leaf *l = head; l != NULL; l = l->next )
+        for( int i = 0; i < l->count; i++ )
+            delete l->items[ i ];
+    freeNodes( root );
+    root = NULL;
+    head = tail = NULL;
+    staged.clear( );
+    unsettled.store( false, std::memory_order_relaxed );
+}
+
+/**
+ * Test if the tree is logically empty.
+ * Return true if empty, false otherwise.
+ */
+template <class Comparable>
+bool BPlusTree<Comparable>::isEmpty( ) const
+{
+    settle( );
+    return root == NULL;
+}
+
+/**
+ * Print the tree contents in sorted order.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::printTree( ) const
+{
+    if( isEmpty( ) )
+        std::cout << "Empty tree" << std::endl;
+    else
+        for( const_iterator it = begin( ); it != end( ); ++it )
+            std::cout << *it << std::endl;
+}
+
+template <class Comparable>
+typename BPlusTree<Comparable>::const_iterator BPlusTree<Comparable>::begin( ) const
+{
+    settle( );
+    return const_iterator( head, 0 );
+}
+
+template <class Comparable>
+typename BPlusTree<Comparable>::const_iterator BPlusTree<Comparable>::end( ) const
+{
+    return const_iterator( NULL, 0 );
+}
+
+/**
+ * Call visit on every item in sorted order, one leaf at a time.
+ */
+template <class Comparable>
+template <class Visit>
+void BPlusTree<Comparable>::for_each( Visit visit ) const
+{
+    settle( );
+    for( const Leaf *l = head; l != NULL; l = l->next )
+        for( int i = 0; i < l->count; i++ )
+            visit( *l->items[ i ] );
+}
+
+/**
+ * Call visit on every item, spread over the threads of pool.
+ * Items are visited in no set order and from several threads at once,
+ * so visit must be safe to call concurrently.
+ */
+template <class Comparable>
+template <class Visit>
+void BPlusTree<Comparable>::parallel_for_each( Visit visit, ThreadPool & pool ) const
+{
+    std::vector<const Leaf *> leaves;
+    std::vector<int> pieces;
+    split( pool, leaves, pieces );
+    pool.run( pieces.size( ) - 1, [&]( int p )
+    {
+        for( int l = pieces[ p ]; l < pieces[ p + 1 ]; l++ )
+            for( int i = 0; i < leaves[ l ]->count; i++ )
+                visit( *leaves[ l ]->items[ i ] );
+    } );
+}
+
+/**
+ * Return identity combined with map( x ) for every item x, that is
+ * combine( ... combine( identity, map( x1 ) ) ..., map( xn ) ).
+ * Each thread folds runs of leaves; their results are then combined in
+ * sorted order, so combine need be associative but not commutative.
+ */
+template <class Comparable>
+template <class T, class Map, class Combine>
+T BPlusTree<Comparable>::parallel_reduce( const T & identity, Map map, Combine combine,
+                                          ThreadPool & pool ) const
+{
+    std::vector<const Leaf *> leaves;
+    std::vector<int> pieces;
+    split( pool, leaves, pieces );
+    std::vector<T> results( pieces.size( ) - 1, identity );
+    pool.run( pieces.size( ) - 1, [&]( int p )
+    {
+        T result = identity;
+        for( int l = pieces[ p ]; l < pieces[ p + 1 ]; l++ )
+            for( int i = 0; i < leaves[ l ]->count; i++ )
+                result = combine( result, map( *leaves[ l ]->items[ i ] ) );
+        results[ p ] = result;
+    } );
+    T total = identity;
+    for( size_t p = 0; p < results.size( ); p++ )
+        total = combine( total, results[ p ] );
+    return total;
+}
+
+/**
+ * Internal method to list the leaves and cut them into about
+ * PIECES_PER_THREAD runs for each thread of pool: run p is
+ * leaves[ pieces[ p ] ] up to but not including leaves[ pieces[ p + 1 ] ].
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::split( ThreadPool & pool, std::vector<const Leaf *> & leaves,
+                                   std::vector<int> & pieces ) const
+{
+    settle( );
+    for( const Leaf *l = head; l != NULL; l = l->next )
+        leaves.push_back( l );
+    int n = leaves.size( );
+    int runs = PIECES_PER_THREAD * pool.size( );
+    if( runs > n )
+        runs = n;
+    for( int p = 0; p <= runs; p++ )
+        pieces.push_back( runs == 0 ? 0 : ( long long ) n * p / runs );
+}
+
+/**
+ * Deep copy. The copies are built into a tree bottom up.
+ */
+template <class Comparable>
+const BPlusTree<Comparable> &
+BPlusTree<Comparable>::
+operator=( const BPlusTree<Comparable> & rhs )
+{
+    if( this != &rhs )
+    {
+        makeEmpty( );
+        std::vector<Comparable *> items;
+        for( const_iterator it = rhs.begin( ); it != rhs.end( ); ++it )
+            items.push_back( new Comparable( *it ) );
+        build( items );
+    }
+    return *this;
+}
+
+/**
+ * Start staging inserts: until end_bulk, insert only appends x to an
+ * unsorted buffer, and the buffer is placed in the tree all at once by
+ * the next query, removal or end_bulk. Meant for loads that are not
+ * queried until they finish, which then skip every search and split.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::begin_bulk( )
+{
+    bulk = true;
+}
+
+/**
+ * Place the staged items and go back to inserting one at a time.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::end_bulk( )
+{
+    settle( );
+    bulk = false;
+}
+
+/**
+ * Move every item of rhs into this tree, leaving rhs empty. An item of
+ * rhs that is already in this tree is dropped. The leaf chains of both
+ * are merged in one linear pass and the tree is rebuilt bottom up.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::merge( BPlusTree<Comparable> & rhs )
+{
+    if( this == &rhs )
+        return;
+    rhs.settle( );
+    std::vector<Comparable *> items;
+    for( Leaf *l = rhs.head; l != NULL; l = l->next )
+        for( int i = 0; i < l->count; i++ )
+            items.push_back( l->items[ i ] );
+    rhs.freeNodes( rhs.root );
+    rhs.root = rhs.head = rhs.tail = NULL;
+    settle( );
+    unite( items );
+}
+
+/**
+ * Move every item x with lo <= x < hi into rhs, replacing what rhs held.
+ * The range is read off the leaf chain and rhs is built from it bottom
+ * up; the items then leave this tree one removal at a time, without
+ * being copied, so this
+ * takes O( log n + k log n ) time for k items.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::extract( const Comparable & lo, const Comparable & hi,
+                                     BPlusTree<Comparable> & rhs )
+{
+    if( this == &rhs )
+        return;
+    settle( );
+    rhs.makeEmpty( );
+    std::vector<Comparable *> items;
+    const Leaf *l = findLeaf( lo );
+    for( int i = l == NULL ? 0 : leafPosition( l, lo ); l != NULL; l = l->next, i = 0 )
+    {
+        for( ; i < l->count && *l->items[ i ] < hi; i++ )
+            items.push_back( l->items[ i ] );
+        if( i < l->count )
+            break;
+    }
+    for( size_t i = 0; i < items.size( ); i++ )
+        detach( *items[ i ] );
+    rhs.build( items );
+}
+
+/**
+ * Internal method to place the staged items in the tree.
+ * They are sorted and then united with the tree; as with insert, an item
+ * already in the tree, or staged earlier, wins over a duplicate staged
+ * later. Const queries that call this at once wait on settling for the
+ * first of them to place the items.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::settle( ) const
+{
+    if( !unsettled.load( std::memory_order_acquire ) )
+        return;
+    std::lock_guard<std::mutex> lock( settling );
+    if( !unsettled.load( std::memory_order_relaxed ) )
+        return;
+    std::stable_sort( staged.begin( ), staged.end( ) );
+    staged.erase( std::unique( staged.begin( ), staged.end( ),
+                               []( const Comparable & a, const Comparable & b ) { return !( a < b ) && !( b < a ); } ),
+                  staged.end( ) );
+    std::vector<Comparable *> items;
+    for( size_t i = 0; i < staged.size( ); i++ )
+        items.push_back( new Comparable( std::move( staged[ i ] ) ) );
+    staged.clear( );
+    unite( items );
+    unsettled.store( false, std::memory_order_release );
+}
+
+/**
+ * Internal method to merge items, which are sorted and free of
+ * duplicates, with the leaf chain in one linear pass, and rebuild the
+ * tree bottom up from the merged run. An item already in the tree wins
+ * over its duplicate in items.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::unite( std::vector<Comparable *> & items ) const
+{
+    if( items.empty( ) )
+        return;
+    std::vector<Comparable *> merged;
+    typename std::vector<Comparable *>::iterator b = items.begin( );
+    for( Leaf *l = head; l != NULL; l = l->next )
+        for( int i = 0; i < l->count; i++ )
+        {
+            while( b != items.end( ) && **b < *l->items[ i ] )
+                merged.push_back( *b++ );
+            if( b != items.end( ) && !( *l->items[ i ] < **b ) )
+                delete *b++;      // Duplicate; keep the one in the tree
+            merged.push_back( l->items[ i ] );
+        }
+    merged.insert( merged.end( ), b, items.end( ) );
+
+    freeNodes( root );
+    build( merged );
+}
+
+/**
+ * Internal method to rebuild the tree from items, which are sorted.
+ * The items are spread evenly over as few leaves as hold them, and each
+ * level of inner nodes likewise over the level below, so every node but
+ * the root is at least half full.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::build( std::vector<Comparable *> & items ) const
+{
+    root = head = tail = NULL;
+    int n = items.size( );
+    if( n == 0 )
+        return;
+
+    std::vector<Node *> level;         // the nodes of one level, left to right
+    std::vector<const Comparable *> lows;   // the smallest item under each of them
+    int leaves = ( n + LEAF_SLOTS - 1 ) / LEAF_SLOTS;
+    for( int k = 0; k < leaves; k++ )
+    {
+        Leaf *l = new Leaf( );
+        for( int i = ( long long ) n * k / leaves; i < ( long long ) n * ( k + 1 ) / leaves; i++ )
+            l->items[ l->count++ ] = items[ i ];
+        l->prev = tail;
+        if( tail != NULL )
+            tail->next = l;
+        else
+            head = l;
+        tail = l;
+        level.push_back( l );
+        lows.push_back( l->items[ 0 ] );
+    }
+
+    while( level.size( ) > 1 )
+    {
+        int m = level.size( );
+        int parents = ( m + INNER_SLOTS - 1 ) / INNER_SLOTS;
+        std::vector<Node *> up;
+        std::vector<const Comparable *> upLows;
+        for( int k = 0; k < parents; k++ )
+        {
+            int from = ( long long ) m * k / parents;
+            int to = ( long long ) m * ( k + 1 ) / parents;
+            Inner *p = new Inner( );
+            p->child[ 0 ] = level[ from ];
+            for( int c = from + 1; c < to; c++ )
+            {
+                p->keys[ p->count ] = lows[ c ];
+                p->child[ ++p->count ] = level[ c ];
+            }
+            up.push_back( p );
+            upLows.push_back( lows[ from ] );
+        }
+        level.swap( up );
+        lows.swap( upLows );
+    }
+    root = level[ 0 ];
+}
+
+/**
+ * Internal method to insert into a subtree.
+ * x is the item to insert, t is the node that roots the subtree.
+ * If t splits, upKey and upNode receive the separator and the new right
+ * sibling for the parent to adopt. Return true if x was inserted.
+ */
+template <class Comparable>
+bool BPlusTree<Comparable>::insert( const Comparable & x, Node *t,
+                                    const Comparable * & upKey, Node * & upNode )
+{
+    upNode = NULL;
+    if( t->leaf )
+    {
+        Leaf *l = static_cast<Leaf *>( t );
+        int i = leafPosition( l, x );
+        if( i < l->count && !( x < *l->items[ i ] ) )
+            return false;  // Duplicate; do nothing
+
+        Comparable *item = new Comparable( x );
+        if( l->count < LEAF_SLOTS )
+        {
+            for( int k = l->count; k > i; k-- )
+                l->items[ k ] = l->items[ k - 1 ];
+            l->items[ i ] = item;
+            l->count++;
+            return true;
+        }
+
+        // Full leaf: split the LEAF_SLOTS + 1 items evenly, then link the new leaf.
+        Leaf *r = new Leaf( );
+        int total = LEAF_SLOTS + 1;
+        int keep = total / 2;
+        for( int k = total - 1, from = LEAF_SLOTS - 1; k >= keep; k-- )
+            r->items[ k - keep ] = ( k == i ) ? item : l->items[ from-- ];
+        for( int k = keep - 1; k >= i; k-- )
+            l->items[ k ] = ( k == i ) ? item : l->items[ k - 1 ];
+        l->count = keep;
+        r->count = total - keep;
+
+        r->next = l->next;
+        r->prev = l;
+        if( l->next != NULL )
+            l->next->prev = r;
+        else
+            tail = r;
+        l->next = r;
+
+        upKey = r->items[ 0 ];
+        upNode = r;
+        return true;
+    }
+
+    Inner *n = static_cast<Inner *>( t );
+    int i = childPosition( n, x );
+    const Comparable *childKey = NULL;
+    Node *childNode = NULL;
+    if( !insert( x, n->child[ i ], childKey, childNode ) )
+        return false;
+    if( childNode == NULL )
+        return true;
+
+    if( n->count < INNER_SLOTS - 1 )
+    {
+        for( int k = n->count; k > i; k-- )
+        {
+            n->keys[ k ] = n->keys[ k - 1 ];
+            n->child[ k + 1 ] = n->child[ k ];
+        }
+        n->keys[ i ] = childKey;
+        n->child[ i + 1 ] = childNode;
+        n->count++;
+        return true;
+    }
+
+    // Full inner node: lay out all keys and children, then push the middle key up.
+    const Comparable *keys[ INNER_SLOTS ];
+    Node *child[ INNER_SLOTS + 1 ];
+    for( int k = 0, from = 0; k < INNER_SLOTS; k++ )
+        keys[ k ] = ( k == i ) ? childKey : n->keys[ from++ ];
+    for( int k = 0, from = 0; k <= INNER_SLOTS; k++ )
+        child[ k ] = ( k == i + 1 ) ? childNode : n->child[ from++ ];
+
+    int mid = INNER_SLOTS / 2;
+    Inner *r = new Inner( );
+    n->count = mid;
+    for( int k = 0; k < mid; k++ )
+    {
+        n->keys[ k ] = keys[ k ];
+        n->child[ k ] = child[ k ];
+    }
+    n->child[ mid ] = child[ mid ];
+    r->count = INNER_SLOTS - mid - 1;
+    for( int k = 0; k < r->count; k++ )
+    {
+        r->keys[ k ] = keys[ mid + 1 + k ];
+        r->child[ k ] = child[ mid + 1 + k ];
+    }
+    r->child[ r->count ] = child[ INNER_SLOTS ];
+
+    upKey = keys[ mid ];
+    upNode = r;
+    return true;
+}
+
+/**
+ * Internal method to remove from a subtree.
+ * Children that fall below half full are refilled by fixChild.
+ * Return true if x was removed.
+ */
+template <class Comparable>
+bool BPlusTree<Comparable>::remove( const Comparable & x, Node *t )
+{
+    if( t->leaf )
+    {
+        Leaf *l = static_cast<Leaf *>( t );
+        int i = leafPosition( l, x );
+        if( i == l->count || x < *l->items[ i ] )
+            return false;
+        for( int k = i + 1; k < l->count; k++ )
+            l->items[ k - 1 ] = l->items[ k ];
+        l->count--;
+        return true;
+    }
+
+    Inner *n = static_cast<Inner *>( t );
+    int i = childPosition( n, x );
+    if( !remove( x, n->child[ i ] ) )
+        return false;
+    Node *c = n->child[ i ];
+    if( c->count < ( c->leaf ? LEAF_MIN : INNER_MIN ) )
+        fixChild( n, i );
+    return true;
+}
+
+/**
+ * Internal method to refill child i of t after a removal, by borrowing
+ * from a sibling that can spare an item or else merging with a sibling.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::fixChild( Inner *t, int i )
+{
+    int li = ( i > 0 ) ? i - 1 : i;      // merge child[li] with child[li + 1]
+    Node *c = t->child[ i ];
+
+    if( c->leaf )
+    {
+        Leaf *l = static_cast<Leaf *>( c );
+        Leaf *left = ( i > 0 ) ? static_cast<Leaf *>( t->child[ i - 1 ] ) : NULL;
+        Leaf *right = ( i < t->count ) ? static_cast<Leaf *>( t->child[ i + 1 ] ) : NULL;
+        if( left != NULL && left->count > LEAF_MIN )
+        {
+            for( int k = l->count; k > 0; k-- )
+                l->items[ k ] = l->items[ k - 1 ];
+            l->items[ 0 ] = left->items[ --left->count ];
+            l->count++;
+            t->keys[ i - 1 ] = l->items[ 0 ];
+            return;
+        }
+        if( right != NULL && right->count > LEAF_MIN )
+        {
+            l->items[ l->count++ ] = right->items[ 0 ];
+            for( int k = 1; k < right->count; k++ )
+                right->items[ k - 1 ] = right->items[ k ];
+            right->count--;
+            t->keys[ i ] = right->items[ 0 ];
+            return;
+        }
+
+        Leaf *a = static_cast<Leaf *>( t->child[ li ] );
+        Leaf *b = static_cast<Leaf *>( t->child[ li + 1 ] );
+        for( int k = 0; k < b->count; k++ )
+            a->items[ a->count++ ] = b->items[ k ];
+        a->next = b->next;
+        if( b->next != NULL )
+            b->next->prev = a;
+        else
+            tail = a;
+        delete b;
+    }
+    else
+    {
+        Inner *n = static_cast<Inner *>( c );
+        Inner *left = ( i > 0 ) ? static_cast<Inner *>( t->child[ i - 1 ] ) : NULL;
+        Inner *right = ( i < t->count ) ? static_cast<Inner *>( t->child[ i + 1 ] ) : NULL;
+        if( left != NULL && left->count > INNER_MIN )   // rotate through the parent
+        {
+            n->child[ n->count + 1 ] = n->child[ n->count ];
+            for( int k = n->count; k > 0; k-- )
+            {
+                n->keys[ k ] = n->keys[ k - 1 ];
+                n->child[ k ] = n->child[ k - 1 ];
+            }
+            n->keys[ 0 ] = t->keys[ i - 1 ];
+            n->child[ 0 ] = left->child[ left->count ];
+            n->count++;
+            t->keys[ i - 1 ] = left->keys[ --left->count ];
+            return;
+        }
+        if( right != NULL && right->count > INNER_MIN )
+        {
+            n->keys[ n->count ] = t->keys[ i ];
+            n->child[ n->count + 1 ] = right->child[ 0 ];
+            n->count++;
+            t->keys[ i ] = right->keys[ 0 ];
+            for( int k = 1; k < right->count; k++ )
+            {
+                right->keys[ k - 1 ] = right->keys[ k ];
+                right->child[ k - 1 ] = right->child[ k ];
+            }
+            right->child[ right->count - 1 ] = right->child[ right->count ];
+            right->count--;
+            return;
+        }
+
+        Inner *a = static_cast<Inner *>( t->child[ li ] );
+        Inner *b = static_cast<Inner *>( t->child[ li + 1 ] );
+        a->keys[ a->count ] = t->keys[ li ];
+        for( int k = 0; k < b->count; k++ )
+        {
+            a->keys[ a->count + 1 + k ] = b->keys[ k ];
+            a->child[ a->count + 1 + k ] = b->child[ k ];
+        }
+        a->child[ a->count + 1 + b->count ] = b->child[ b->count ];
+        a->count += b->count + 1;
+        delete b;
+    }
+
+    // child[li + 1] was merged into child[li]: drop it and its separator.
+    for( int k = li + 1; k < t->count; k++ )
+    {
+        t->keys[ k - 1 ] = t->keys[ k ];
+        t->child[ k ] = t->child[ k + 1 ];
+    }
+    t->count--;
+}
+
+/**
+ * Return the index of the first item in leaf t that is not less than x.
+ */
+template <class Comparable>
+int BPlusTree<Comparable>::leafPosition( const Leaf *t, const Comparable & x ) const
+{
+    int lo = 0, hi = t->count;
+    while( lo < hi )
+    {
+        int mid = ( lo + hi ) / 2;
+        if( *t->items[ mid ] < x )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Return the index of the child of t whose subtree would hold x.
+ */
+template <class Comparable>
+int BPlusTree<Comparable>::childPosition( const Inner *t, const Comparable & x ) const
+{
+    int lo = 0, hi = t->count;
+    while( lo < hi )
+    {
+        int mid = ( lo + hi ) / 2;
+        if( x < *t->keys[ mid ] )
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+/**
+ * Internal method to find the leaf that would hold x, or NULL if empty.
+ */
+template <class Comparable>
+const typename BPlusTree<Comparable>::Leaf *
+BPlusTree<Comparable>::findLeaf( const Comparable & x ) const
+{
+    const Node *t = root;
+    while( t != NULL && !t->leaf )
+    {
+        const Inner *n = static_cast<const Inner *>( t );
+        t = n->child[ childPosition( n, x ) ];
+    }
+    return static_cast<const Leaf *>( t );
+}
+
+/**
+ * Internal method to free the nodes of a subtree, but not its items.
+ */
+template <class Comparable>
+void BPlusTree<Comparable>::freeNodes( Node *t ) const
+{
+    if( t == NULL )
+        return;
+    if( t->leaf )
+    {
+        delete static_cast<Leaf *>( t );
+        return;
+    }
+    Inner *n = static_cast<Inner *>( t );
+    for( int k = 0; k <= n->count; k++ )
+        freeNodes( n->child[ k ] );
+    delete n;
+}
@@ -0,0 +1,174 @@
+/******************************************************************************
+Title : BPlusTree.h
+Author : Yu Tong Chen
+Created on : 04/18/2019
+Description : The interface of BPlusTree, a drop-in alternative to AvlTree
+              that packs several items per node and links its leaves.
+Usage : Include this file; BPlusTree.cpp is pulled in below.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef _BPLUS_TREE_H_
+#define _BPLUS_TREE_H_
+
+#include "thread_pool.h"
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+template<class Comparable>
+class BPlusTree;
+
+// BPlusTree class
+//
+// CONSTRUCTION: with ITEM_NOT_FOUND object used to signal failed finds
+//
+// ******************PUBLIC OPERATIONS*********************
+// void insert( x )       --> Insert x
+// void remove( x )       --> Remove x
+// Comparable find( x )   --> Return item that matches x
+// Comparable findMin( )  --> Return smallest item
+// Comparable findMax( )  --> Return largest item
+// boolean isEmpty( )     --> Return true if empty; else false
+// void makeEmpty( )      --> Remove all items
+// void printTree( )      --> Print tree in sorted order
+// void for_each( f )     --> Call f on every item in sorted order
+// void parallel_for_each( f )      --> Call f on every item, in no set order,
+//                                      on the threads of a ThreadPool
+// T parallel_reduce( id, map, c )  --> Combine map( x ) of every item with c,
+//                                      in parallel
+// void begin_bulk( )     --> Stage inserts instead of placing them
+// void end_bulk( )       --> Place the staged items and stop staging
+// void merge( rhs )      --> Move every item of rhs into this tree
+// void extract( lo, hi, rhs ) --> Move the items in [lo, hi) into rhs
+// begin( ), end( )       --> Iterate over the items in sorted order
+//
+// Items live only in the leaves, which are chained left to right, so a
+// full scan walks the leaf chain instead of the tree. Each item is kept
+// on the heap and the nodes hold pointers to it, so a node's fanout does
+// not depend on sizeof( Comparable ): a 512-byte node has 64 item slots
+// in a leaf and 32 children in an inner node. The separators in inner
+// nodes point at items in the leaves; an item is unhooked from them
+// before it is freed.
+
+template <class Comparable>
+class BPlusTree
+{
+  public:
+    // Bytes of pointers per node, and the resulting slots per node.
+    static const int NODE_BYTES    = 512;
+    static const int LEAF_SLOTS    = NODE_BYTES / sizeof( void * );         // items per leaf
+    static const int INNER_SLOTS   = NODE_BYTES / ( 2 * sizeof( void * ) ); // children per inner node
+    static const int LEAF_MIN      = LEAF_SLOTS / 2;
+    static const int INNER_MIN     = ( INNER_SLOTS + 1 ) / 2 - 1;  // keys
+    // runs of leaves handed to each thread of the pool, for load balance
+    static const int PIECES_PER_THREAD = 8;
+
+  private:
+    struct Node
+    {
+        bool leaf;
+        int  count;           // items in a leaf, keys in an inner node
+        explicit Node( bool isLeaf ) : leaf( isLeaf ), count( 0 ) { }
+    };
+    struct Leaf : public Node
+    {
+        Comparable *items[ LEAF_SLOTS ];
+        Leaf      *prev;
+        Leaf      *next;
+        Leaf( ) : Node( true ), prev( NULL ), next( NULL ) { }
+    };
+    struct Inner : public Node
+    {
+        const Comparable *keys[ INNER_SLOTS - 1 ];   // child[i] holds items < *keys[i]
+        Node             *child[ INNER_SLOTS ];
+        Inner( ) : Node( false ) { }
+    };
+
+  public:
+    class const_iterator
+    {
+      public:
+        const_iterator( ) : leaf( NULL ), pos( 0 ) { }
+        const Comparable & operator*( ) const { return *leaf->items[ pos ]; }
+        const Comparable * operator->( ) const { return leaf->items[ pos ]; }
+        const_iterator & operator++( );
+        bool operator==( const const_iterator & rhs ) const
+            { return leaf == rhs.leaf && pos == rhs.pos; }
+        bool operator!=( const const_iterator & rhs ) const
+            { return !( *this == rhs ); }
+      private:
+        const Leaf *leaf;
+        int         pos;
+        const_iterator( const Leaf *l, int p ) : leaf( l ), pos( p ) { }
+        friend class BPlusTree<Comparable>;
+    };
+
+    BPlusTree( );
+    explicit BPlusTree( const Comparable & notFound );
+    BPlusTree( const BPlusTree & rhs );
+    ~BPlusTree( );
+
+    const Comparable & findMin( ) const;
+    const Comparable & findMax( ) const;
+    const Comparable & find( const Comparable & x ) const;
+    bool isEmpty( ) const;
+    void printTree( ) const;
+
+    const_iterator begin( ) const;
+    const_iterator end( ) const;
+
+    template <class Visit>
+    void for_each( Visit visit ) const;
+    template <class Visit>
+    void parallel_for_each( Visit visit, ThreadPool & pool = ThreadPool::shared( ) ) const;
+    template <class T, class Map, class Combine>
+    T parallel_reduce( const T & identity, Map map, Combine combine,
+                       ThreadPool & pool = ThreadPool::shared( ) ) const;
+
+    void makeEmpty( );
+    void insert( const Comparable & x );
+    void remove( const Comparable & x );
+
+    void begin_bulk( );
+    void end_bulk( );
+    void merge( BPlusTree & rhs );
+    void extract( const Comparable & lo, const Comparable & hi, BPlusTree & rhs );
+
+    const BPlusTree & operator=( const BPlusTree & rhs );
+
+  private:
+    // As in AvlTree, a const query first places the staged items, so the
+    // nodes and staged change under const methods; settle does so holding
+    // settling, which makes const queries safe to run at once, but not
+    // alongside insert, remove or the like.
+    mutable Node    *root;
+    mutable Leaf    *head;        // leftmost leaf
+    mutable Leaf    *tail;        // rightmost leaf
+    const Comparable ITEM_NOT_FOUND;
+    bool             bulk;        // true between begin_bulk and end_bulk
+    mutable std::vector<Comparable> staged;   // inserted since the last query, unsorted
+    mutable std::atomic<bool> unsettled;      // true while staged is not empty
+    mutable std::mutex        settling;
+
+    bool insert( const Comparable & x, Node *t, const Comparable * & upKey, Node * & upNode );
+    Comparable * detach( const Comparable & x );
+    void unhook( const Comparable & x, const Comparable *old, const Comparable *next );
+    bool remove( const Comparable & x, Node *t );
+    void fixChild( Inner *t, int i );
+    int  leafPosition( const Leaf *t, const Comparable & x ) const;
+    int  childPosition( const Inner *t, const Comparable & x ) const;
+    const Leaf * findLeaf( const Comparable & x ) const;
+    void split( ThreadPool & pool, std::vector<const Leaf *> & leaves,
+                std::vector<int> & pieces ) const;
+    void freeNodes( Node *t ) const;
+    void settle( ) const;
+    void unite( std::vector<Comparable *> & items ) const;
+    void build( std::vector<Comparable *> & items ) const;
+};
+
+#include "BPlusTree.cpp"
+#endif
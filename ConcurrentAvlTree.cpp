@@ -0,0 +1,463 @@
+/******************************************************************************
+Title : ConcurrentAvlTree.cpp
+Author : Yu Tong Chen
+Created on : 04/02/2019
+Description : The implementation of ConcurrentAvlTree.h.
+Usage : Included by ConcurrentAvlTree.h; do not compile separately.
+Build with : Makefile (needs -pthread)
+Modifications:
+    The balancing cases follow AvlTree.cpp, rewritten so that every
+    rotation builds new nodes instead of relinking published ones.
+
+******************************************************************************/
+
+#include "ConcurrentAvlTree.h"
+
+
+/**
+ * Construct the tree.
+ */
+template <class Comparable>
+ConcurrentAvlTree<Comparable>::ConcurrentAvlTree( ) :
+    root( NULL ), global_epoch( 1 )
+{
+    for( int i = 0; i < MAX_READERS; i++ )
+    {
+        readers[ i ].in_use.store( false );
+        readers[ i ].epoch.store( QUIESCENT );
+    }
+}
+
+/**
+ * Destructor for the tree. No reader may still be pinned.
+ */
+template <class Comparable>
+ConcurrentAvlTree<Comparable>::~ConcurrentAvlTree( )
+{
+    freeTree( root.load( ) );
+    for( size_t i = 0; i < retired.size( ); i++ )
+        delete retired[ i ].node;
+}
+
+/**
+ * Pin the current version for the lifetime of the reader.
+ */
+template <class Comparable>
+ConcurrentAvlTree<Comparable>::Reader::Reader( const ConcurrentAvlTree & tree ) :
+    owner( tree ), slot( tree.acquireSlot( ) ), pinned_root( tree.root.load( ) )
+{
+}
+
+template <class Comparable>
+ConcurrentAvlTree<Comparable>::Reader::~Reader( )
+{
+    owner.releaseSlot( slot );
+}
+
+/**
+ * Claim a free reader slot and announce the epoch it reads in.
+ * Lock-free: it only spins if MAX_READERS readers are already pinned.
+ */
+template <class Comparable>
+int ConcurrentAvlTree<Comparable>::acquireSlot( ) const
+{
+    for( int i = 0; ; i = ( i + 1 ) % MAX_READERS )
+    {
+        bool expected = false;
+        if( readers[ i ].in_use.compare_exchange_strong( expected, true ) )
+        {
+            readers[ i ].epoch.store( global_epoch.load( ) );
+            return i;
+        }
+    }
+}
+
+template <class Comparable>
+void ConcurrentAvlTree<Comparable>::releaseSlot( int slot ) const
+{
+    readers[ slot ].epoch.store( QUIESCENT );
+    readers[ slot ].in_use.store( false );
+}
+
+/**
+ * Copy the item matching x into out.
+ * Return true if it was found.
+ */
+template <class Comparable>
+bool ConcurrentAvlTree<Comparable>::find( const Comparable & x, Comparable & out ) const
+{
+    Reader r( *this );
+    const Node *t = find( x, r.root( ) );
+    if( t == NULL )
+        return false;
+    out = t->element;
+    return true;
+}
+
+/**
+ * Return true if x is in the current version.
+ */
+template <class Comparable>
+bool ConcurrentAvlTree<Comparable>::contains( const Comparable & x ) const
+{
+    Reader r( *this );
+    return find( x, r.root( ) ) != NULL;
+}
+
+/**
+ * Return the number of items in the current version.
+ */
+template <class Comparable>
+int ConcurrentAvlTree<Comparable>::size( ) const
+{
+    Reader r( *this );
+    return count( r.root( ) );
+}
+
+/**
+ * Test if the tree is logically empty.
+ */
+template <class Comparable>
+bool ConcurrentAvlTree<Comparable>::isEmpty( ) const
+{
+    return root.load( ) == NULL;
+}
+
+/**
+ * Call visit on every item of one version, in sorted order.
+ */
+template <class Comparable>
+template <class Visit>
+void ConcurrentAvlTree<Comparable>::for_each( Visit visit ) const
+{
+    Reader r( *this );
+    for_each( r.root( ), visit );
+}
+
+/**
+ * Call visit on every item of the version r pins, in sorted order, so
+ * that several passes can read the same version.
+ */
+template <class Comparable>
+template <class Visit>
+void ConcurrentAvlTree<Comparable>::for_each( const Reader & r, Visit visit ) const
+{
+    for_each( r.root( ), visit );
+}
+
+/**
+ * Return the number of items in the version r pins.
+ */
+template <class Comparable>
+int ConcurrentAvlTree<Comparable>::size( const Reader & r ) const
+{
+    return count( r.root( ) );
+}
+
+/**
+ * Make the tree logically empty.
+ */
+template <class Comparable>
+void ConcurrentAvlTree<Comparable>::makeEmpty( )
+{
+    std::lock_guard<std::mutex> guard( writer_lock );
+    std::vector<const Node *> stack;
+    if( root.load( ) != NULL )
+        stack.push_back( root.load( ) );
+    while( !stack.empty( ) )
+    {
+        const Node *t = stack.back( );
+        stack.pop_back( );
+        if( t->left != NULL )
+            stack.push_back( t->left );
+        if( t->right != NULL )
+            stack.push_back( t->right );
+        retire( t );
+    }
+    publish( NULL );
+}
+
+/**
+ * Insert x into the tree; duplicates are ignored.
+ * Return true if x was added.
+ */
+template <class Comparable>
+bool ConcurrentAvlTree<Comparable>::insert( const Comparable & x )
+{
+    std::lock_guard<std::mutex> guard( writer_lock );
+    bool changed = false;
+    Node *new_root = insert( x, root.load( ), changed );
+    if( changed )
+        publish( new_root );
+    return changed;
+}
+
+/**
+ * Remove x from the tree. Nothing is done if x is not found.
+ * Return true if x was removed.
+ */
+template <class Comparable>
+bool ConcurrentAvlTree<Comparable>::remove( const Comparable & x )
+{
+    std::lock_guard<std::mutex> guard( writer_lock );
+    bool changed = false;
+    Node *new_root = remove( x, root.load( ), changed );
+    if( changed )
+        publish( new_root );
+    return changed;
+}
+
+/**
+ * Swap in the new root, then tag every node the write replaced with the
+ * epoch it was retired in. Caller holds writer_lock.
+ */
+template <class Comparable>
+void ConcurrentAvlTree<Comparable>::publish( Node *new_root )
+{
+    root.store( new_root );
+    unsigned long epoch = global_epoch.fetch_add( 1 );
+    for( size_t i = 0; i < pending.size( ); i++ )
+    {
+        Retired r = { pending[ i ], epoch };
+        retired.push_back( r );
+    }
+    pending.clear( );
+    reclaim( );
+}
+
+/**
+ * Free every retired node that no pinned reader can still reach.
+ * Caller holds writer_lock.
+ */
+template <class Comparable>
+void ConcurrentAvlTree<Comparable>::reclaim( )
+{
+    unsigned long oldest = QUIESCENT;
+    for( int i = 0; i < MAX_READERS; i++ )
+    {
+        unsigned long e = readers[ i ].epoch.load( );
+        if( e < oldest )
+            oldest = e;
+    }
+
+    size_t kept = 0;
+    for( size_t i = 0; i < retired.size( ); i++ )
+    {
+        if( retired[ i ].epoch < oldest )
+            delete retired[ i ].node;
+        else
+            retired[ kept++ ] = retired[ i ];
+    }
+    retired.resize( kept );
+}
+
+/**
+ * Internal method to insert into a subtree.
+ * Return the root of the new version of t; changed is set if x was added.
+ */
+template <class Comparable>
+ConcurrentAvlNode<Comparable> *
+ConcurrentAvlTree<Comparable>::insert( const Comparable & x, Node *t, bool & changed )
+{
+    if( t == NULL )
+    {
+        changed = true;
+        return makeNode( x, NULL, NULL );
+    }
+    if( x < t->element )
+    {
+        Node *l = insert( x, t->left, changed );
+        if( !changed )
+            return t;
+        retire( t );
+        return balance( t->element, l, t->right );
+    }
+    if( t->element < x )
+    {
+        Node *r = insert( x, t->right, changed );
+        if( !changed )
+            return t;
+        retire( t );
+        return balance( t->element, t->left, r );
+    }
+    return t;  // Duplicate; do nothing
+}
+
+/**
+ * Internal method to remove from a subtree.
+ * Return the root of the new version of t; changed is set if x was removed.
+ */
+template <class Comparable>
+ConcurrentAvlNode<Comparable> *
+ConcurrentAvlTree<Comparable>::remove( const Comparable & x, Node *t, bool & changed )
+{
+    if( t == NULL )
+        return NULL;
+    if( x < t->element )
+    {
+        Node *l = remove( x, t->left, changed );
+        if( !changed )
+            return t;
+        retire( t );
+        return balance( t->element, l, t->right );
+    }
+    if( t->element < x )
+    {
+        Node *r = remove( x, t->right, changed );
+        if( !changed )
+            return t;
+        retire( t );
+        return balance( t->element, t->left, r );
+    }
+
+    changed = true;
+    retire( t );
+    if( t->left != NULL && t->right != NULL )
+    {
+        const Comparable *min = NULL;
+        Node *r = removeMin( t->right, min );
+        return balance( *min, t->left, r );
+    }
+    return t->left != NULL ? t->left : t->right;
+}
+
+/**
+ * Internal method to detach the smallest node of a non-empty subtree.
+ * min points at its element, which stays valid until the next reclaim.
+ */
+template <class Comparable>
+ConcurrentAvlNode<Comparable> *
+ConcurrentAvlTree<Comparable>::removeMin( Node *t, const Comparable * & min )
+{
+    retire( t );
+    if( t->left == NULL )
+    {
+        min = &t->element;
+        return t->right;
+    }
+    Node *l = removeMin( t->left, min );
+    return balance( t->element, l, t->right );
+}
+
+/**
+ * Build a node holding x over l and r, rotating if their heights differ
+ * by two. Nodes taken apart by a rotation are retired.
+ */
+template <class Comparable>
+ConcurrentAvlNode<Comparable> *
+ConcurrentAvlTree<Comparable>::balance( const Comparable & x, Node *l, Node *r )
+{
+    if( height( l ) - height( r ) == 2 )
+    {
+        retire( l );
+        if( height( l->left ) >= height( l->right ) )      // single rotation
+            return makeNode( l->element, l->left, makeNode( x, l->right, r ) );
+        Node *lr = l->right;                                // double rotation
+        retire( lr );
+        return makeNode( lr->element, makeNode( l->element, l->left, lr->left ),
+                         makeNode( x, lr->right, r ) );
+    }
+    if( height( r ) - height( l ) == 2 )
+    {
+        retire( r );
+        if( height( r->right ) >= height( r->left ) )      // single rotation
+            return makeNode( r->element, makeNode( x, l, r->left ), r->right );
+        Node *rl = r->left;                                 // double rotation
+        retire( rl );
+        return makeNode( rl->element, makeNode( x, l, rl->left ),
+                         makeNode( r->element, rl->right, r->right ) );
+    }
+    return makeNode( x, l, r );
+}
+
+template <class Comparable>
+ConcurrentAvlNode<Comparable> *
+ConcurrentAvlTree<Comparable>::makeNode( const Comparable & x, Node *l, Node *r ) const
+{
+    return new Node( x, l, r, max( height( l ), height( r ) ) + 1,
+                     count( l ) + count( r ) + 1 );
+}
+
+/**
+ * Queue t to be retired when the write in progress is published.
+ */
+template <class Comparable>
+void ConcurrentAvlTree<Comparable>::retire( const Node *t )
+{
+    pending.push_back( t );
+}
+
+/**
+ * Internal method to find an item in a subtree.
+ */
+template <class Comparable>
+const ConcurrentAvlNode<Comparable> *
+ConcurrentAvlTree<Comparable>::find( const Comparable & x, const Node *t ) const
+{
+    while( t != NULL )
+        if( x < t->element )
+            t = t->left;
+        else if( t->element < x )
+            t = t->right;
+        else
+            return t;    // Match
+
+    return NULL;   // No match
+}
+
+/**
+ * Internal method to delete a subtree outright; only used when no
+ * reader can be pinned.
+ */
+template <class Comparable>
+void ConcurrentAvlTree<Comparable>::freeTree( const Node *t )
+{
+    if( t != NULL )
+    {
+        freeTree( t->left );
+        freeTree( t->right );
+        delete t;
+    }
+}
+
+/**
+ * Internal method to visit a subtree in sorted order.
+ */
+template <class Comparable>
+template <class Visit>
+void ConcurrentAvlTree<Comparable>::for_each( const Node *t, Visit & visit ) const
+{
+    if( t != NULL )
+    {
+        for_each( t->left, visit );
+        visit( t->element );
+        for_each( t->right, visit );
+    }
+}
+
+/**
+ * Return the height of node t, or -1, if NULL.
+ */
+template <class Comparable>
+int ConcurrentAvlTree<Comparable>::height( const Node *t ) const
+{
+    return t == NULL ? -1 : t->height;
+}
+
+/**
+ * Return the number of nodes under t, or 0, if NULL.
+ */
+template <class Comparable>
+int ConcurrentAvlTree<Comparable>::count( const Node *t ) const
+{
+    return t == NULL ? 0 : t->size;
+}
+
+/**
+ * Return maximum of lhs and rhs.
+ */
+template <class Comparable>
+int ConcurrentAvlTree<Comparable>::max( int lhs, int rhs ) const
+{
+    return lhs > rhs ? lhs : rhs;
+}
@@ -0,0 +1,156 @@
+/******************************************************************************
+Title : ConcurrentAvlTree.h
+Author : Yu Tong Chen
+Created on : 04/02/2019
+Description : The interface of ConcurrentAvlTree, an AVL tree whose readers
+              never block while a writer inserts or removes.
+Usage : Include this file; ConcurrentAvlTree.cpp is pulled in below.
+Build with : Makefile (needs -pthread)
+Modifications:
+
+******************************************************************************/
+
+#ifndef _CONCURRENT_AVL_TREE_H_
+#define _CONCURRENT_AVL_TREE_H_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+template<class Comparable>
+class ConcurrentAvlTree;
+
+/** class ConcurrentAvlNode
+ *  A node that is never modified once it is reachable from a published
+ *  root. Writers build new nodes along the search path instead.
+ */
+template <class Comparable>
+class ConcurrentAvlNode
+{
+public:
+    const Comparable         element;
+    ConcurrentAvlNode *const left;
+    ConcurrentAvlNode *const right;
+    const int                height;
+    const int                size;      // number of nodes in this subtree
+
+    ConcurrentAvlNode( const Comparable & theElement, ConcurrentAvlNode *lt,
+                       ConcurrentAvlNode *rt, int h, int sz )
+            : element( theElement ), left( lt ), right( rt ),
+              height( h ), size( sz ) { }
+    friend class ConcurrentAvlTree<Comparable>;
+};
+
+// ConcurrentAvlTree class
+//
+// CONSTRUCTION: with no parameters
+//
+// ******************PUBLIC OPERATIONS*********************
+// bool insert( x )       --> Insert x; true if added (one writer at a time)
+// bool remove( x )       --> Remove x; true if found (one writer at a time)
+// bool find( x, out )    --> Copy the item matching x into out
+// bool contains( x )     --> Return true if x is present
+// int size( )            --> Return number of items in the current version
+// bool isEmpty( )        --> Return true if empty; else false
+// void makeEmpty( )      --> Remove all items
+// void for_each( f )     --> Call f on every item of one version, in order
+// void for_each( r, f )  --> Call f on every item of the version r pins
+// int size( r )          --> Return number of items in the version r pins
+//
+// Writers copy the search path and publish the new root with one atomic
+// store. Readers pin an epoch, load the root, and see that version until
+// they unpin. Replaced nodes are retired with the epoch they were retired
+// in and freed once no reader is pinned at or before that epoch.
+
+template <class Comparable>
+class ConcurrentAvlTree
+{
+  public:
+    typedef ConcurrentAvlNode<Comparable> Node;
+
+    ConcurrentAvlTree( );
+    ~ConcurrentAvlTree( );
+
+    /** class Reader
+     *  Pins the tree for the lifetime of the object. Every node reachable
+     *  from root() stays valid until the Reader is destroyed.
+     */
+    class Reader
+    {
+      public:
+        explicit Reader( const ConcurrentAvlTree & tree );
+        ~Reader( );
+        const Node * root( ) const { return pinned_root; }
+      private:
+        const ConcurrentAvlTree & owner;
+        int                       slot;
+        const Node               *pinned_root;
+        Reader( const Reader & );
+        Reader & operator=( const Reader & );
+    };
+
+    bool find( const Comparable & x, Comparable & out ) const;
+    bool contains( const Comparable & x ) const;
+    int  size( ) const;
+    bool isEmpty( ) const;
+
+    template <class Visit>
+    void for_each( Visit visit ) const;
+
+    template <class Visit>
+    void for_each( const Reader & r, Visit visit ) const;
+    int  size( const Reader & r ) const;
+
+    void makeEmpty( );
+    bool insert( const Comparable & x );
+    bool remove( const Comparable & x );
+
+    static const int MAX_READERS = 64;
+
+  private:
+    struct Retired
+    {
+        const Node   *node;
+        unsigned long epoch;
+    };
+    struct ReaderSlot
+    {
+        std::atomic<bool>          in_use;
+        std::atomic<unsigned long> epoch;
+    };
+    static const unsigned long QUIESCENT = ~0UL;
+
+    std::atomic<Node *>          root;
+    std::atomic<unsigned long>   global_epoch;
+    mutable ReaderSlot           readers[MAX_READERS];
+    std::mutex                   writer_lock;
+    std::vector<Retired>         retired;      // guarded by writer_lock
+    std::vector<const Node *>    pending;      // nodes replaced by this write
+
+    int  acquireSlot( ) const;
+    void releaseSlot( int slot ) const;
+    void publish( Node *new_root );
+    void reclaim( );
+
+    Node * insert( const Comparable & x, Node *t, bool & changed );
+    Node * remove( const Comparable & x, Node *t, bool & changed );
+    Node * removeMin( Node *t, const Comparable * & min );
+    Node * balance( const Comparable & x, Node *l, Node *r );
+    Node * makeNode( const Comparable & x, Node *l, Node *r ) const;
+    void   retire( const Node *t );
+    const Node * find( const Comparable & x, const Node *t ) const;
+    void   freeTree( const Node *t );
+
+    template <class Visit>
+    void for_each( const Node *t, Visit & visit ) const;
+
+    int height( const Node *t ) const;
+    int count( const Node *t ) const;
+    int max( int lhs, int rhs ) const;
+
+    ConcurrentAvlTree( const ConcurrentAvlTree & );
+    ConcurrentAvlTree & operator=( const ConcurrentAvlTree & );
+};
+
+#include "ConcurrentAvlTree.cpp"
+#endif
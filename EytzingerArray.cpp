@@ -0,0 +1,173 @@
+/******************************************************************************
+Title : EytzingerArray.cpp
+Author : Yu Tong Chen
+Created on : 04/22/2019
+Description : The implementation of EytzingerArray.h.
+Usage : Included by EytzingerArray.h; do not compile separately.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "EytzingerArray.h"
+
+
+/**
+ * Construct the array.
+ */
+template <class Comparable>
+EytzingerArray<Comparable>::EytzingerArray( ) : n( 0 ), ITEM_NOT_FOUND( )
+{
+}
+
+/**
+ * Construct the array.
+ */
+template <class Comparable>
+EytzingerArray<Comparable>::EytzingerArray( const Comparable & notFound ) :
+    n( 0 ), ITEM_NOT_FOUND( notFound )
+{
+}
+
+/**
+ * Replace the contents with the items of sorted, which must be in
+ * increasing order without duplicates.
+ */
+template <class Comparable>
+void EytzingerArray<Comparable>::build( const std::vector<Comparable> & sorted )
+{
+    n = sorted.size( );
+    slots.assign( n + 1, ITEM_NOT_FOUND );
+    slots.shrink_to_fit( );
+    int i = 0;
+    fill( sorted, i, 1 );
+}
+
+/**
+ * Make the array logically empty and release its memory.
+ */
+template <class Comparable>
+void EytzingerArray<Comparable>::makeEmpty( )
+{
+    std::vector<Comparable>( ).swap( slots );
+    n = 0;
+}
+
+template <class Comparable>
+int EytzingerArray<Comparable>::size( ) const
+{
+    return n;
+}
+
+template <class Comparable>
+bool EytzingerArray<Comparable>::isEmpty( ) const
+{
+    return n == 0;
+}
+
+/**
+ * Find item x in the array.
+ * Return the matching item or ITEM_NOT_FOUND if not found.
+ */
+template <class Comparable>
+const Comparable & EytzingerArray<Comparable>::find( const Comparable & x ) const
+{
+    int k = lower_bound( x );
+    if( k != 0 && !( x < slots[ k ] ) )
+        return slots[ k ];
+    return ITEM_NOT_FOUND;
+}
+
+/**
+ * Return the slot of the first item not less than x, or 0 if there is none.
+ * The loop has no data-dependent branch: each step moves to child 2k or
+ * 2k+1 by adding the comparison result. When it falls off the bottom, the
+ * answer is the last node where the search went left, which is found by
+ * stripping the trailing 1 bits (right turns) and one more bit.
+ */
+template <class Comparable>
+int EytzingerArray<Comparable>::lower_bound( const Comparable & x ) const
+{
+    const Comparable *a = slots.data( );
+    unsigned int k = 1;
+    while( k <= ( unsigned int ) n )
+    {
+        if( 4 * k <= ( unsigned int ) n )
+            __builtin_prefetch( a + 4 * k );
+        k = 2 * k + ( a[ k ] < x );
+    }
+    k >>= __builtin_ffs( ~k );
+    return k;
+}
+
+/**
+ * Return the slot of the in-order successor of slot k, or 0 if none.
+ */
+template <class Comparable>
+int EytzingerArray<Comparable>::next( int k ) const
+{
+    if( 2 * k + 1 <= n )              // leftmost slot of the right subtree
+    {
+        k = 2 * k + 1;
+        while( 2 * k <= n )
+            k = 2 * k;
+        return k;
+    }
+    while( k & 1 )                    // climb while coming from a right child
+        k >>= 1;
+    return k >> 1;
+}
+
+/**
+ * Return the item in slot k, or ITEM_NOT_FOUND for slot 0.
+ */
+template <class Comparable>
+const Comparable & EytzingerArray<Comparable>::at( int k ) const
+{
+    return k == 0 ? ITEM_NOT_FOUND : slots[ k ];
+}
+
+/**
+ * Call visit on every item x with lo <= x <= hi, in sorted order.
+ */
+template <class Comparable>
+template <class Visit>
+void EytzingerArray<Comparable>::for_each_in_range( const Comparable & lo,
+                                                    const Comparable & hi,
+                                                    Visit visit ) const
+{
+    for( int k = lower_bound( lo ); k != 0 && !( hi < slots[ k ] ); k = next( k ) )
+        visit( slots[ k ] );
+}
+
+/**
+ * Call visit on every item in sorted order.
+ */
+template <class Comparable>
+template <class Visit>
+void EytzingerArray<Comparable>::for_each( Visit visit ) const
+{
+    if( n == 0 )
+        return;
+    int k = 1;
+    while( 2 * k <= n )
+        k = 2 * k;
+    for( ; k != 0; k = next( k ) )
+        visit( slots[ k ] );
+}
+
+/**
+ * Internal method to place sorted[i...] into the subtree rooted at slot k
+ * by an in-order walk of the implicit tree.
+ */
+template <class Comparable>
+void EytzingerArray<Comparable>::fill( const std::vector<Comparable> & sorted,
+                                       int & i, int k )
+{
+    if( k <= n )
+    {
+        fill( sorted, i, 2 * k );
+        slots[ k ] = sorted[ i++ ];
+        fill( sorted, i, 2 * k + 1 );
+    }
+}
@@ -0,0 +1,71 @@
+/******************************************************************************
+Title : EytzingerArray.h
+Author : Yu Tong Chen
+Created on : 04/22/2019
+Description : The interface of EytzingerArray, a read-only sorted set kept
+              in one array in breadth-first (Eytzinger) order.
+Usage : Include this file; EytzingerArray.cpp is pulled in below.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef _EYTZINGER_ARRAY_H_
+#define _EYTZINGER_ARRAY_H_
+
+#include <vector>
+
+// EytzingerArray class
+//
+// CONSTRUCTION: with ITEM_NOT_FOUND object used to signal failed finds
+//
+// ******************PUBLIC OPERATIONS*********************
+// void build( v )        --> Replace the contents with sorted vector v
+// Comparable find( x )   --> Return item that matches x
+// int lower_bound( x )   --> Return slot of first item >= x, 0 if none
+// int next( k )          --> Return slot of the item after slot k, 0 if none
+// Comparable at( k )     --> Return the item in slot k
+// void for_each_in_range( lo, hi, f ) --> Call f on items in [lo, hi]
+// void for_each( f )     --> Call f on every item in sorted order
+// int size( )            --> Return number of items
+// void makeEmpty( )      --> Remove all items
+//
+// Slot k holds the root of a complete binary search tree whose children
+// are slots 2k and 2k+1, so there are no pointers or heights to store.
+// A search always walks the same slots from the top, which keeps the top
+// levels in cache, and the next-but-one level is prefetched while the
+// current comparison runs.
+
+template <class Comparable>
+class EytzingerArray
+{
+  public:
+    EytzingerArray( );
+    explicit EytzingerArray( const Comparable & notFound );
+
+    void build( const std::vector<Comparable> & sorted );
+    void makeEmpty( );
+    int  size( ) const;
+    bool isEmpty( ) const;
+
+    const Comparable & find( const Comparable & x ) const;
+    int  lower_bound( const Comparable & x ) const;
+    int  next( int k ) const;
+    const Comparable & at( int k ) const;
+
+    template <class Visit>
+    void for_each_in_range( const Comparable & lo, const Comparable & hi,
+                            Visit visit ) const;
+    template <class Visit>
+    void for_each( Visit visit ) const;
+
+  private:
+    std::vector<Comparable> slots;     // slots[0] is unused
+    int                     n;
+    Comparable              ITEM_NOT_FOUND;
+
+    void fill( const std::vector<Comparable> & sorted, int & i, int k );
+};
+
+#include "EytzingerArray.cpp"
+#endif
@@ -0,0 +1,717 @@
+/******************************************************************************
+Title : PersistentAvlTree.cpp
+Author : Yu Tong Chen
+Created on : 04/05/2019
+Description : The implementation of PersistentAvlTree.h.
+Usage : Included by PersistentAvlTree.h; do not compile separately.
+Build with : Makefile
+Modifications:
+    The balancing cases follow AvlTree.cpp. A node only this tree can reach
+    is relinked in place, as AvlTree does; one a snapshot shares is copied
+    first, so the shared subtrees are never changed.
+
+******************************************************************************/
+
+#include "PersistentAvlTree.h"
+
+// Ownership convention for the internal methods: a const Node * argument
+// is borrowed, a Node * argument is handed over together with one
+// reference, and every Node * returned carries one reference for the caller.
+
+
+/**
+ * Construct the tree.
+ */
+template <class Comparable>
+PersistentAvlTree<Comparable>::PersistentAvlTree( ) :
+    root( NULL ), ITEM_NOT_FOUND( )
+{
+}
+
+/**
+ * Construct the tree.
+ */
+template <class Comparable>
+PersistentAvlTree<Comparable>::PersistentAvlTree( const Comparable & notFound ) :
+    root( NULL ), ITEM_NOT_FOUND( notFound )
+{
+}
+
+/**
+ * Copy constructor. Shares every node with rhs.
+ */
+template <class Comparable>
+PersistentAvlTree<Comparable>::PersistentAvlTree( const PersistentAvlTree<Comparable> & rhs ) :
+    root( retain( rhs.root ) ), ITEM_NOT_FOUND( rhs.ITEM_NOT_FOUND )
+{
+}
+
+/**
+ * Destructor for the tree.
+ */
+template <class Comparable>
+PersistentAvlTree<Comparable>::~PersistentAvlTree( )
+{
+    release( root );
+}
+
+/**
+ * Insert x into the tree; duplicates are ignored.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::insert( const Comparable & x )
+{
+    if( find( x, root ) != NULL )
+        return;
+    insertInPlace( x, root );
+}
+
+/**
+ * Remove x from the tree. Nothing is done if x is not found.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::remove( const Comparable & x )
+{
+    if( find( x, root ) == NULL )
+        return;
+    removeInPlace( x, root );
+}
+
+/**
+ * Insert every item of rhs; an item already in the tree is kept.
+ * When rhs is small next to this tree its items are inserted one at a
+ * time; otherwise both trees are merged in one linear pass and the
+ * result is built afresh, perfectly balanced. Snapshots taken earlier
+ * keep their nodes either way.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::merge( const PersistentAvlTree<Comparable> & rhs )
+{
+    int n = size( ), m = rhs.size( );
+    int depth = 1;
+    while( ( 1 << depth ) < n )
+        depth++;
+    if( ( long long ) m * depth < n )
+    {
+        rhs.for_each( [ this ]( const Comparable & x ) { insert( x ); } );
+        return;
+    }
+
+    std::vector<const Comparable *> mine, theirs, items;
+    mine.reserve( n );
+    theirs.reserve( m );
+    for_each( [ &mine ]( const Comparable & x ) { mine.push_back( &x ); } );
+    rhs.for_each( [ &theirs ]( const Comparable & x ) { theirs.push_back( &x ); } );
+    items.reserve( n + m );
+    size_t a = 0, b = 0;
+    while( a < mine.size( ) && b < theirs.size( ) )
+    {
+        if( *theirs[ b ] < *mine[ a ] )
+            items.push_back( theirs[ b++ ] );
+        else
+        {
+            if( !( *mine[ a ] < *theirs[ b ] ) )
+                b++;      // Duplicate; keep the one in the tree
+            items.push_back( mine[ a++ ] );
+        }
+    }
+    items.insert( items.end( ), mine.begin( ) + a, mine.end( ) );
+    items.insert( items.end( ), theirs.begin( ) + b, theirs.end( ) );
+
+    Node *new_root = build( items, 0, items.size( ) );
+    release( root );
+    root = new_root;
+}
+
+/**
+ * Replace the items of the tree with *items[ 0 ], *items[ 1 ], ..., which
+ * are sorted and distinct, building a perfectly balanced tree in linear
+ * time. Snapshots taken earlier keep their nodes.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::assign( const std::vector<const Comparable *> & items )
+{
+    Node *new_root = build( items, 0, items.size( ) );
+    release( root );
+    root = new_root;
+}
+
+/**
+ * Remove every item x with lo <= x < hi, in O( log n ) time however many
+ * there are: the new version is the join of the part below lo and the
+ * part from hi on, which copy only the nodes along the two search paths.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::remove_range( const Comparable & lo, const Comparable & hi )
+{
+    if( !( lo < hi ) )
+        return;
+    Node *new_root = join( below( root, lo ), notBelow( root, hi ) );
+    release( root );
+    root = new_root;
+}
+
+/**
+ * Find the smallest item in the tree.
+ * Return smallest item or ITEM_NOT_FOUND if empty.
+ */
+template <class Comparable>
+const Comparable & PersistentAvlTree<Comparable>::findMin( ) const
+{
+    const Node *t = root;
+    while( t != NULL && t->left != NULL )
+        t = t->left;
+    return elementAt( t );
+}
+
+/**
+ * Find the largest item in the tree.
+ * Return the largest item of ITEM_NOT_FOUND if empty.
+ */
+template <class Comparable>
+const Comparable & PersistentAvlTree<Comparable>::findMax( ) const
+{
+    const Node *t = root;
+    while( t != NULL && t->right != NULL )
+        t = t->right;
+    return elementAt( t );
+}
+
+/**
+ * Find item x in the tree.
+ * Return the matching item or ITEM_NOT_FOUND if not found.
+ */
+template <class Comparable>
+const Comparable & PersistentAvlTree<Comparable>::find( const Comparable & x ) const
+{
+    return elementAt( find( x, root ) );
+}
+
+/**
+ * Return true if x is in the tree.
+ */
+template <class Comparable>
+bool PersistentAvlTree<Comparable>::contains( const Comparable & x ) const
+{
+    return find( x, root ) != NULL;
+}
+
+/**
+ * Return the number of items in the tree.
+ */
+template <class Comparable>
+int PersistentAvlTree<Comparable>::size( ) const
+{
+    return count( root );
+}
+
+/**
+ * Make the tree logically empty. Snapshots taken earlier keep their nodes.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::makeEmpty( )
+{
+    release( root );
+    root = NULL;
+}
+
+/**
+ * Test if the tree is logically empty.
+ * Return true if empty, false otherwise.
+ */
+template <class Comparable>
+bool PersistentAvlTree<Comparable>::isEmpty( ) const
+{
+    return root == NULL;
+}
+
+/**
+ * Print the tree contents in sorted order.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::printTree( ) const
+{
+    if( isEmpty( ) )
+        std::cout << "Empty tree" << std::endl;
+    else
+        for_each( [ ]( const Comparable & x ) { std::cout << x << std::endl; } );
+}
+
+/**
+ * Call visit on every item in sorted order.
+ */
+template <class Comparable>
+template <class Visit>
+void PersistentAvlTree<Comparable>::for_each( Visit visit ) const
+{
+    for_each( root, visit );
+}
+
+/**
+ * Shallow copy: both trees share rhs's nodes afterwards.
+ */
+template <class Comparable>
+const PersistentAvlTree<Comparable> &
+PersistentAvlTree<Comparable>::
+operator=( const PersistentAvlTree<Comparable> & rhs )
+{
+    if( this != &rhs )
+    {
+        Node *old_root = root;
+        root = retain( rhs.root );
+        release( old_root );
+    }
+    return *this;
+}
+
+/**
+ * Internal method to get element field in node t.
+ * Return the element field or ITEM_NOT_FOUND if t is NULL.
+ */
+template <class Comparable>
+const Comparable & PersistentAvlTree<Comparable>::elementAt( const Node *t ) const
+{
+    return t == NULL ? ITEM_NOT_FOUND : t->element;
+}
+
+/**
+ * Internal method to insert into a subtree that does not contain x.
+ * Return the root of the new version of t.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::insert( const Comparable & x, const Node *t ) const
+{
+    if( t == NULL )
+        return makeNode( x, NULL, NULL );
+    if( x < t->element )
+        return balance( t->element, insert( x, t->left ), retain( t->right ) );
+    else
+        return balance( t->element, retain( t->left ), insert( x, t->right ) );
+}
+
+/**
+ * Internal method to remove from a subtree that contains x.
+ * Return the root of the new version of t.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::remove( const Comparable & x, const Node *t ) const
+{
+    if( x < t->element )
+        return balance( t->element, remove( x, t->left ), retain( t->right ) );
+    if( t->element < x )
+        return balance( t->element, retain( t->left ), remove( x, t->right ) );
+
+    if( t->left != NULL && t->right != NULL )   // two non-empty subtrees
+    {
+        const Node *min = t->right;
+        while( min->left != NULL )
+            min = min->left;
+        return balance( min->element, retain( t->left ), removeMin( t->right ) );
+    }
+    return retain( t->left != NULL ? t->left : t->right );
+}
+
+/**
+ * Internal method to insert into a subtree that does not contain x.
+ * t is the link to the subtree, which this tree can reach without going
+ * through a shared node. A node no other tree refers to is changed in
+ * place, as AvlTree does; from the first shared node down the path is
+ * copied instead, and t is pointed at the copy.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::insertInPlace( const Comparable & x, Node * & t ) const
+{
+    if( t == NULL )
+        t = makeNode( x, NULL, NULL );
+    else if( t->refs.load( ) > 1 )
+    {
+        Node *copy = insert( x, t );
+        release( t );
+        t = copy;
+    }
+    else
+    {
+        if( x < t->element )
+            insertInPlace( x, t->left );
+        else
+            insertInPlace( x, t->right );
+        rebalance( t );
+    }
+}
+
+/**
+ * Internal method to remove from a subtree that contains x, changing the
+ * nodes no other tree refers to in place as insertInPlace does.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::removeInPlace( const Comparable & x, Node * & t ) const
+{
+    if( t->refs.load( ) > 1 )
+    {
+        Node *copy = remove( x, t );
+        release( t );
+        t = copy;
+        return;
+    }
+    if( x < t->element )
+        removeInPlace( x, t->left );
+    else if( t->element < x )
+        removeInPlace( x, t->right );
+    else if( t->left != NULL && t->right != NULL )   // two non-empty subtrees
+    {
+        const Node *min = t->right;
+        while( min->left != NULL )
+            min = min->left;
+        t->element = min->element;
+        removeInPlace( t->element, t->right );
+    }
+    else
+    {
+        Node *oldNode = t;
+        t = retain( t->left != NULL ? t->left : t->right );
+        release( oldNode );
+        return;
+    }
+    rebalance( t );
+}
+
+/**
+ * Internal method to restore the balance of a node no other tree refers
+ * to, after one of its subtrees grew or shrank by one, and to update its
+ * height and size.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::rebalance( Node * & t ) const
+{
+    if( height( t->left ) - height( t->right ) == 2 )
+    {
+        if( height( t->left->left ) < height( t->left->right ) )
+        {
+            own( t->left );
+            rotateWithRightChild( t->left );
+        }
+        rotateWithLeftChild( t );
+    }
+    else if( height( t->right ) - height( t->left ) == 2 )
+    {
+        if( height( t->right->right ) < height( t->right->left ) )
+        {
+            own( t->right );
+            rotateWithLeftChild( t->right );
+        }
+        rotateWithRightChild( t );
+    }
+    else
+        update( t );
+}
+
+/**
+ * Rotate binary tree node with left child, in place. k2 is not shared;
+ * its left child is copied first if it is.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::rotateWithLeftChild( Node * & k2 ) const
+{
+    own( k2->left );
+    Node *k1 = k2->left;
+    k2->left = k1->right;
+    k1->right = k2;
+    update( k2 );
+    update( k1 );
+    k2 = k1;
+}
+
+/**
+ * Rotate binary tree node with right child, in place. k1 is not shared;
+ * its right child is copied first if it is.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::rotateWithRightChild( Node * & k1 ) const
+{
+    own( k1->right );
+    Node *k2 = k1->right;
+    k1->right = k2->left;
+    k2->left = k1;
+    update( k1 );
+    update( k2 );
+    k1 = k2;
+}
+
+/**
+ * Internal method to make t a node no other tree refers to, replacing it
+ * with a copy that shares its children if it is shared.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::own( Node * & t ) const
+{
+    if( t->refs.load( ) == 1 )
+        return;
+    Node *copy = new Node( t->element, retain( t->left ), retain( t->right ),
+                           t->height, t->size );
+    release( t );
+    t = copy;
+}
+
+/**
+ * Internal method to recompute the height and size of t from its children.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::update( Node *t ) const
+{
+    t->height = max( height( t->left ), height( t->right ) ) + 1;
+    t->size = count( t->left ) + count( t->right ) + 1;
+}
+
+/**
+ * Internal method to drop the smallest item of a non-empty subtree.
+ * Return the root of the new version of t.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::removeMin( const Node *t ) const
+{
+    if( t->left == NULL )
+        return retain( t->right );
+    return balance( t->element, removeMin( t->left ), retain( t->right ) );
+}
+
+/**
+ * Build a node holding x over l and r, rotating if their heights differ
+ * by two. A child taken apart by a rotation is released.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::balance( const Comparable & x, Node *l, Node *r ) const
+{
+    Node *result;
+    if( height( l ) - height( r ) == 2 )
+    {
+        if( height( l->left ) >= height( l->right ) )      // single rotation
+            result = makeNode( l->element, retain( l->left ),
+                               makeNode( x, retain( l->right ), r ) );
+        else                                                // double rotation
+        {
+            Node *lr = l->right;
+            result = makeNode( lr->element,
+                               makeNode( l->element, retain( l->left ), retain( lr->left ) ),
+                               makeNode( x, retain( lr->right ), r ) );
+        }
+        release( l );
+        return result;
+    }
+    if( height( r ) - height( l ) == 2 )
+    {
+        if( height( r->right ) >= height( r->left ) )      // single rotation
+            result = makeNode( r->element, makeNode( x, l, retain( r->left ) ),
+                               retain( r->right ) );
+        else                                                // double rotation
+        {
+            Node *rl = r->left;
+            result = makeNode( rl->element,
+                               makeNode( x, l, retain( rl->left ) ),
+                               makeNode( r->element, retain( rl->right ), retain( r->right ) ) );
+        }
+        release( r );
+        return result;
+    }
+    return makeNode( x, l, r );
+}
+
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::makeNode( const Comparable & x, Node *l, Node *r ) const
+{
+    return new Node( x, l, r, max( height( l ), height( r ) ) + 1,
+                     count( l ) + count( r ) + 1 );
+}
+
+/**
+ * Internal method to build a perfectly balanced subtree of *items[ lo ]
+ * up to but not including *items[ hi ], which are sorted.
+ * Return the root of the subtree.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::build( const std::vector<const Comparable *> & items,
+                                      int lo, int hi ) const
+{
+    if( lo >= hi )
+        return NULL;
+    int mid = lo + ( hi - lo ) / 2;
+    Node *l = build( items, lo, mid );
+    Node *r = build( items, mid + 1, hi );
+    return makeNode( *items[ mid ], l, r );
+}
+
+/**
+ * Internal method to build a new version of the items of subtree t that
+ * are less than x. t is left as it was.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::below( const Node *t, const Comparable & x ) const
+{
+    if( t == NULL )
+        return NULL;
+    if( t->element < x )
+        return join( retain( t->left ), t->element, below( t->right, x ) );
+    return below( t->left, x );
+}
+
+/**
+ * Internal method to build a new version of the items of subtree t that
+ * are not less than x. t is left as it was.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::notBelow( const Node *t, const Comparable & x ) const
+{
+    if( t == NULL )
+        return NULL;
+    if( t->element < x )
+        return notBelow( t->right, x );
+    return join( notBelow( t->left, x ), t->element, retain( t->right ) );
+}
+
+/**
+ * Internal method to join l, x and r, whose items are in that order, by
+ * copying the spine of the taller of l and r down to where the shorter
+ * fits. Takes over the references to l and r.
+ * Return the root of the joined version.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::join( Node *l, const Comparable & x, Node *r ) const
+{
+    Node *result;
+    if( height( l ) > height( r ) + 1 )
+    {
+        result = balance( l->element, retain( l->left ), join( retain( l->right ), x, r ) );
+        release( l );
+        return result;
+    }
+    if( height( r ) > height( l ) + 1 )
+    {
+        result = balance( r->element, join( l, x, retain( r->left ) ), retain( r->right ) );
+        release( r );
+        return result;
+    }
+    return makeNode( x, l, r );
+}
+
+/**
+ * Internal method to join l and r, whose items are in that order, around
+ * the smallest item of r. Takes over the references to l and r.
+ * Return the root of the joined version.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::join( Node *l, Node *r ) const
+{
+    if( r == NULL )
+        return l;
+    const Node *min = r;
+    while( min->left != NULL )
+        min = min->left;
+    Node *result = join( l, min->element, removeMin( r ) );
+    release( r );
+    return result;
+}
+
+/**
+ * Internal method to find an item in a subtree.
+ */
+template <class Comparable>
+const PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::find( const Comparable & x, const Node *t ) const
+{
+    while( t != NULL )
+        if( x < t->element )
+            t = t->left;
+        else if( t->element < x )
+            t = t->right;
+        else
+            return t;    // Match
+
+    return NULL;   // No match
+}
+
+/**
+ * Internal method to visit a subtree in sorted order.
+ */
+template <class Comparable>
+template <class Visit>
+void PersistentAvlTree<Comparable>::for_each( const Node *t, Visit & visit ) const
+{
+    if( t != NULL )
+    {
+        for_each( t->left, visit );
+        visit( t->element );
+        for_each( t->right, visit );
+    }
+}
+
+/**
+ * Add a reference to t. Return t.
+ */
+template <class Comparable>
+PersistentAvlNode<Comparable> *
+PersistentAvlTree<Comparable>::retain( Node *t )
+{
+    if( t != NULL )
+        t->refs.fetch_add( 1 );
+    return t;
+}
+
+/**
+ * Drop a reference to t, freeing every node that is no longer shared.
+ * Uses an explicit stack so that dropping a whole tree cannot overflow.
+ */
+template <class Comparable>
+void PersistentAvlTree<Comparable>::release( Node *t )
+{
+    std::vector<Node *> stack;
+    if( t != NULL )
+        stack.push_back( t );
+    while( !stack.empty( ) )
+    {
+        Node *n = stack.back( );
+        stack.pop_back( );
+        if( n->refs.fetch_sub( 1 ) != 1 )
+            continue;
+        if( n->left != NULL )
+            stack.push_back( n->left );
+        if( n->right != NULL )
+            stack.push_back( n->right );
+        delete n;
+    }
+}
+
+/**
+ * Return the height of node t, or -1, if NULL.
+ */
+template <class Comparable>
+int PersistentAvlTree<Comparable>::height( const Node *t ) const
+{
+    return t == NULL ? -1 : t->height;
+}
+
+/**
+ * Return the number of nodes under t, or 0, if NULL.
+ */
+template <class Comparable>
+int PersistentAvlTree<Comparable>::count( const Node *t ) const
+{
+    return t == NULL ? 0 : t->size;
+}
+
+/**
+ * Return maximum of lhs and rhs.
+ */
+template <class Comparable>
+int PersistentAvlTree<Comparable>::max( int lhs, int rhs ) const
+{
+    return lhs > rhs ? lhs : rhs;
+}
@@ -0,0 +1,138 @@
+/******************************************************************************
+Title : PersistentAvlTree.h
+Author : Yu Tong Chen
+Created on : 04/05/2019
+Description : The interface of PersistentAvlTree, an AVL tree whose copies
+              share structure, so a copy is a point-in-time snapshot.
+Usage : Include this file; PersistentAvlTree.cpp is pulled in below.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef _PERSISTENT_AVL_TREE_H_
+#define _PERSISTENT_AVL_TREE_H_
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+template<class Comparable>
+class PersistentAvlTree;
+
+/** class PersistentAvlNode
+ *  A reference-counted node; any number of trees may point at it. A node
+ *  is changed in place only while one tree alone can reach it; once it is
+ *  shared it is never changed again.
+ */
+template <class Comparable>
+class PersistentAvlNode
+{
+public:
+    Comparable         element;
+    PersistentAvlNode *left;
+    PersistentAvlNode *right;
+    int                height;
+    int                size;      // number of nodes in this subtree
+
+    PersistentAvlNode( const Comparable & theElement, PersistentAvlNode *lt,
+                       PersistentAvlNode *rt, int h, int sz )
+            : element( theElement ), left( lt ), right( rt ),
+              height( h ), size( sz ), refs( 1 ) { }
+    friend class PersistentAvlTree<Comparable>;
+private:
+    std::atomic<int> refs;
+};
+
+// PersistentAvlTree class
+//
+// CONSTRUCTION: with ITEM_NOT_FOUND object used to signal failed finds
+//
+// ******************PUBLIC OPERATIONS*********************
+// void insert( x )       --> Insert x
+// void remove( x )       --> Remove x
+// Comparable find( x )   --> Return item that matches x
+// Comparable findMin( )  --> Return smallest item
+// Comparable findMax( )  --> Return largest item
+// int size( )            --> Return number of items
+// boolean isEmpty( )     --> Return true if empty; else false
+// void makeEmpty( )      --> Remove all items
+// void merge( rhs )      --> Insert every item of rhs
+// void assign( items )   --> Replace the items with the sorted *items[ i ]
+// void remove_range( lo, hi ) --> Remove the items in [lo, hi)
+// void for_each( f )     --> Call f on every item in sorted order
+// void printTree( )      --> Print tree in sorted order
+//
+// Copying a tree or assigning one to another is O(1): both share the root.
+// insert and remove copy only the nodes on the search path that another
+// tree shares, at most O(log n) of them, and change the rest in place; the
+// replaced nodes are freed as soon as no tree refers to them.
+
+template <class Comparable>
+class PersistentAvlTree
+{
+  public:
+    PersistentAvlTree( );
+    explicit PersistentAvlTree( const Comparable & notFound );
+    PersistentAvlTree( const PersistentAvlTree & rhs );
+    ~PersistentAvlTree( );
+
+    const Comparable & findMin( ) const;
+    const Comparable & findMax( ) const;
+    const Comparable & find( const Comparable & x ) const;
+    bool contains( const Comparable & x ) const;
+    int  size( ) const;
+    bool isEmpty( ) const;
+    void printTree( ) const;
+
+    template <class Visit>
+    void for_each( Visit visit ) const;
+
+    void makeEmpty( );
+    void insert( const Comparable & x );
+    void remove( const Comparable & x );
+    void merge( const PersistentAvlTree & rhs );
+    void assign( const std::vector<const Comparable *> & items );
+    void remove_range( const Comparable & lo, const Comparable & hi );
+
+    const PersistentAvlTree & operator=( const PersistentAvlTree & rhs );
+
+  private:
+    typedef PersistentAvlNode<Comparable> Node;
+
+    Node            *root;
+    const Comparable ITEM_NOT_FOUND;
+
+    const Comparable & elementAt( const Node *t ) const;
+    Node * insert( const Comparable & x, const Node *t ) const;
+    Node * remove( const Comparable & x, const Node *t ) const;
+    void   insertInPlace( const Comparable & x, Node * & t ) const;
+    void   removeInPlace( const Comparable & x, Node * & t ) const;
+    void   rebalance( Node * & t ) const;
+    void   rotateWithLeftChild( Node * & k2 ) const;
+    void   rotateWithRightChild( Node * & k1 ) const;
+    void   own( Node * & t ) const;
+    void   update( Node *t ) const;
+    Node * removeMin( const Node *t ) const;
+    Node * balance( const Comparable & x, Node *l, Node *r ) const;
+    Node * makeNode( const Comparable & x, Node *l, Node *r ) const;
+    const Node * find( const Comparable & x, const Node *t ) const;
+    Node * build( const std::vector<const Comparable *> & items, int lo, int hi ) const;
+    Node * below( const Node *t, const Comparable & x ) const;
+    Node * notBelow( const Node *t, const Comparable & x ) const;
+    Node * join( Node *l, const Comparable & x, Node *r ) const;
+    Node * join( Node *l, Node *r ) const;
+
+    template <class Visit>
+    void for_each( const Node *t, Visit & visit ) const;
+
+    static Node * retain( Node *t );
+    static void   release( Node *t );
+
+    int height( const Node *t ) const;
+    int count( const Node *t ) const;
+    int max( int lhs, int rhs ) const;
+};
+
+#include "PersistentAvlTree.cpp"
+#endif
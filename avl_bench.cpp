@@ -0,0 +1,326 @@
+/******************************************************************************
+Title : avl_bench.cpp
+Author : Yu Tong Chen
+Created on : 05/30/2019
+Description : Times AvlTree's insert, remove, copy, makeEmpty and for_each
+              on random and on ascending ints, next to the recursive AVL
+              tree it replaced and to std::set doing the same, and checks
+              that all three end up holding the same items.
+Usage : make bench && build/bench [n]
+Build with : Makefile (built with -O2)
+Modifications:
+
+******************************************************************************/
+
+#include "AvlTree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+
+
+using namespace std;
+
+static int failures = 0;
+
+/**
+ * The recursive AVL tree AvlTree started from, kept here as the baseline
+ * to time it against: insert, remove, makeEmpty, clone and the walk all
+ * recurse once per level. Only remove differs from the original, whose
+ * rebalancing after a removal used the rotations of the other side; it
+ * uses the mirrored cases, so the items it leaves can be checked.
+ */
+template <class Comparable>
+class RecursiveAvl
+{
+  public:
+    RecursiveAvl( ) : root( NULL ) { }
+    RecursiveAvl( const RecursiveAvl & rhs ) : root( clone( rhs.root ) ) { }
+    ~RecursiveAvl( ) { makeEmpty( root ); }
+
+    void insert( const Comparable & x ) { insert( x, root ); }
+    void remove( const Comparable & x ) { remove( x, root ); }
+    void makeEmpty( ) { makeEmpty( root ); }
+    bool isEmpty( ) const { return root == NULL; }
+    const Comparable & findMax( ) const
+    {
+        Node *t = root;
+        while( t->right != NULL )
+            t = t->right;
+        return t->element;
+    }
+    template <class Visit>
+    void for_each( Visit visit ) const { for_each( root, visit ); }
+
+  private:
+    struct Node
+    {
+        Comparable element;
+        Node      *left;
+        Node      *right;
+        int        height;
+        Node( const Comparable & e, Node *lt, Node *rt, int h = 0 )
+            : element( e ), left( lt ), right( rt ), height( h ) { }
+    };
+    Node *root;
+
+    RecursiveAvl & operator=( const RecursiveAvl & );
+
+    static int height( Node *t ) { return t == NULL ? -1 : t->height; }
+    static void fixHeight( Node *t )
+    {
+        t->height = std::max( height( t->left ), height( t->right ) ) + 1;
+    }
+
+    static void rotateWithLeftChild( Node * & k2 )
+    {
+        Node *k1 = k2->left;
+        k2->left = k1->right;
+        k1->right = k2;
+        fixHeight( k2 );
+        fixHeight( k1 );
+        k2 = k1;
+    }
+    static void rotateWithRightChild( Node * & k1 )
+    {
+        Node *k2 = k1->right;
+        k1->right = k2->left;
+        k2->left = k1;
+        fixHeight( k1 );
+        fixHeight( k2 );
+        k1 = k2;
+    }
+    static void doubleWithLeftChild( Node * & k3 )
+    {
+        rotateWithRightChild( k3->left );
+        rotateWithLeftChild( k3 );
+    }
+    static void doubleWithRightChild( Node * & k1 )
+    {
+        rotateWithLeftChild( k1->right );
+        rotateWithRightChild( k1 );
+    }
+
+    static void insert( const Comparable & x, Node * & t )
+    {
+        if( t == NULL )
+            t = new Node( x, NULL, NULL );
+        else if( x < t->element )
+        {
+            insert( x, t->left );
+            if( height( t->left ) - height( t->right ) == 2 )
+            {
+                if( x < t->left->element )
+                    rotateWithLeftChild( t );
+                else
+                    doubleWithLeftChild( t );
+            }
+        }
+        else if( t->element < x )
+        {
+            insert( x, t->right );
+            if( height( t->right ) - height( t->left ) == 2 )
+            {
+                if( t->right->element < x )
+                    rotateWithRightChild( t );
+                else
+                    doubleWithRightChild( t );
+            }
+        }
+        fixHeight( t );
+    }
+
+    static void rightTooTall( Node * & t )
+    {
+        if( height( t->right ) - height( t->left ) == 2 )
+        {
+            if( height( t->right->right ) >= height( t->right->left ) )
+                rotateWithRightChild( t );
+            else
+                doubleWithRightChild( t );
+        }
+    }
+    static void leftTooTall( Node * & t )
+    {
+        if( height( t->left ) - height( t->right ) == 2 )
+        {
+            if( height( t->left->left ) >= height( t->left->right ) )
+                rotateWithLeftChild( t );
+            else
+                doubleWithLeftChild( t );
+        }
+    }
+
+    static void remove( const Comparable & x, Node * & t )
+    {
+        if( t == NULL )
+            return;
+        if( x < t->element )
+        {
+            remove( x, t->left );
+            rightTooTall( t );
+        }
+        else if( t->element < x )
+        {
+            remove( x, t->right );
+            leftTooTall( t );
+        }
+        else if( t->left != NULL && t->right != NULL )
+        {
+            Node *min = t->right;
+            while( min->left != NULL )
+                min = min->left;
+            t->element = min->element;
+            remove( t->element, t->right );
+            leftTooTall( t );
+        }
+        else
+        {
+            Node *oldNode = t;
+            t = ( t->left != NULL ) ? t->left : t->right;
+            delete oldNode;
+        }
+        if( t != NULL )
+            fixHeight( t );
+    }
+
+    static void makeEmpty( Node * & t )
+    {
+        if( t != NULL )
+        {
+            makeEmpty( t->left );
+            makeEmpty( t->right );
+            delete t;
+        }
+        t = NULL;
+    }
+    static Node * clone( Node *t )
+    {
+        if( t == NULL )
+            return NULL;
+        return new Node( t->element, clone( t->left ), clone( t->right ), t->height );
+    }
+    template <class Visit>
+    static void for_each( Node *t, Visit & visit )
+    {
+        if( t != NULL )
+        {
+            for_each( t->left, visit );
+            visit( t->element );
+            for_each( t->right, visit );
+        }
+    }
+};
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void check(bool ok, const char *what) {
+    if (!ok && failures++ < 10)
+        fprintf(stderr, "bench: %s\n", what);
+}
+
+/* inserts every key, walks, copies and empties the copy, then removes every other key in
+ * the order given, putting the time each step takes in times; sum is what the walk added up
+ * and left what the removals left
+ */
+template <class Tree>
+static void time_tree(Tree & tree, const vector<int> & keys, double times[],
+                      long long & sum, vector<int> & left) {
+    chrono::steady_clock::time_point start;
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++)
+        tree.insert(keys[i]);
+    times[0] = seconds_since(start);
+
+    sum = 0;
+    start = chrono::steady_clock::now();
+    tree.for_each([&sum](int x) { sum += x; });
+    times[1] = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    Tree copy(tree);
+    times[2] = seconds_since(start);
+    check(copy.findMax() == tree.findMax(), "copy differs");
+
+    start = chrono::steady_clock::now();
+    copy.makeEmpty();
+    times[3] = seconds_since(start);
+    check(copy.isEmpty(), "makeEmpty left items");
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i += 2)
+        tree.remove(keys[i]);
+    times[4] = seconds_since(start);
+
+    left.clear();
+    tree.for_each([&left](int x) { left.push_back(x); });
+}
+
+// times the steps on AvlTree, on the recursive tree it replaced and on std::set, and prints them
+static void run(const char *name, const vector<int> & keys) {
+    chrono::steady_clock::time_point start;
+    double avl[5], rec[5], ref[5];
+    long long avl_sum, rec_sum;
+    vector<int> avl_left, rec_left;
+
+    AvlTree<int> tree(-1);
+    time_tree(tree, keys, avl, avl_sum, avl_left);
+    RecursiveAvl<int> recursive;
+    time_tree(recursive, keys, rec, rec_sum, rec_left);
+
+    set<int> reference;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++)
+        reference.insert(keys[i]);
+    ref[0] = seconds_since(start);
+
+    long long reference_sum = 0;
+    start = chrono::steady_clock::now();
+    for (set<int>::const_iterator it = reference.begin(); it != reference.end(); ++it)
+        reference_sum += *it;
+    ref[1] = seconds_since(start);
+    check(avl_sum == reference_sum, "AvlTree's for_each saw other items than std::set holds");
+    check(rec_sum == reference_sum, "the recursive for_each saw other items than std::set holds");
+
+    start = chrono::steady_clock::now();
+    set<int> reference_copy(reference);
+    ref[2] = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    reference_copy.clear();
+    ref[3] = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i += 2)
+        reference.erase(keys[i]);
+    ref[4] = seconds_since(start);
+
+    vector<int> reference_left(reference.begin(), reference.end());
+    check(avl_left == reference_left, "AvlTree's remove left other items than std::set");
+    check(rec_left == reference_left, "the recursive remove left other items than std::set");
+
+    static const char *STEPS[] = { "insert", "for_each", "copy", "makeEmpty", "remove half" };
+    printf("%zu %s keys\n  %-12s %9s %9s %9s\n", keys.size(), name, "", "AvlTree", "recursive", "std::set");
+    for (int s = 0; s < 5; s++)
+        printf("  %-12s %8.3fs %8.3fs %8.3fs\n", STEPS[s], avl[s], rec[s], ref[s]);
+}
+
+int main(int argc, char *argv[]) {
+    int n = (argc > 1) ? atoi(argv[1]) : 1000000;
+
+    vector<int> keys(n);
+    for (int i = 0; i < n; i++)
+        keys[i] = i;
+    run("ascending", keys);
+
+    shuffle(keys.begin(), keys.end(), mt19937(1));
+    run("random", keys);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,315 @@
+/******************************************************************************
+Title : change_log.cpp
+Author : Yu Tong Chen
+Created on : 04/08/2019
+Description : The implementation of change_log.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "change_log.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char   MAGIC[8] = {'T','R','E','E','L','O','G','1'};
+static const size_t MAX_PAYLOAD = 1 << 16;
+
+// helper function to compute the CRC-32 (IEEE) of a buffer
+static unsigned int crc32(const string & data) {
+    static unsigned int table[256];
+    static bool built = false;
+    if (!built) {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        built = true;
+    }
+    unsigned int crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < data.size(); i++)
+        crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// helpers to write and read fixed-width little endian fields
+static void put_u32(string & buf, unsigned int v) {
+    for (int i = 0; i < 4; i++)
+        buf += (char)((v >> (8 * i)) & 0xFF);
+}
+
+static unsigned int get_u32(const string & buf, size_t & pos) {
+    unsigned int v = 0;
+    for (int i = 0; i < 4; i++)
+        v |= (unsigned int)(unsigned char)buf[pos + i] << (8 * i);
+    pos += 4;
+    return v;
+}
+
+static void put_string(string & buf, const string & s) {
+    buf += (char)(s.size() & 0xFF);
+    buf += (char)((s.size() >> 8) & 0xFF);
+    buf += s;
+}
+
+static bool get_string(const string & buf, size_t & pos, string & s) {
+    if (pos + 2 > buf.size())
+        return false;
+    size_t len = (unsigned char)buf[pos] | ((unsigned char)buf[pos + 1] << 8);
+    pos += 2;
+    if (pos + len > buf.size())
+        return false;
+    s = buf.substr(pos, len);
+    pos += len;
+    return true;
+}
+
+static void put_double(string & buf, double d) {
+    char bytes[sizeof(double)];
+    memcpy(bytes, &d, sizeof(double));
+    buf.append(bytes, sizeof(double));
+}
+
+static double get_double(const string & buf, size_t & pos) {
+    double d;
+    memcpy(&d, buf.data() + pos, sizeof(double));
+    pos += sizeof(double);
+    return d;
+}
+
+// serializes t in the payload layout described in change_log.h
+static string encode(const Tree & t) {
+    string buf;
+    double lat, lon;
+    t.get_position(lat, lon);
+    put_u32(buf, (unsigned int)t.id());
+    put_u32(buf, (unsigned int)t.diameter());
+    put_u32(buf, (unsigned int)t.zip_code());
+    put_string(buf, t.life_status());
+    put_string(buf, t.tree_health());
+    put_string(buf, t.common_name());
+    put_string(buf, t.nearest_address());
+    put_string(buf, t.borough_name());
+    put_double(buf, lat);
+    put_double(buf, lon);
+    return buf;
+}
+
+// rebuilds a Tree from a payload, returns false if it is malformed
+static bool decode(const string & buf, Tree & t) {
+    size_t pos = 0;
+    string stat, hlth, name, addr, boro;
+    if (buf.size() < 12)
+        return false;
+    int id   = (int)get_u32(buf, pos);
+    int diam = (int)get_u32(buf, pos);
+    int zip  = (int)get_u32(buf, pos);
+    if (!get_string(buf, pos, stat) || !get_string(buf, pos, hlth) || !get_string(buf, pos, name)
+        || !get_string(buf, pos, addr) || !get_string(buf, pos, boro)
+        || pos + 2 * sizeof(double) != buf.size())
+        return false;
+    double lat = get_double(buf, pos);
+    double lon = get_double(buf, pos);
+    t = Tree(id, diam, stat, hlth, name, zip, addr, boro, lat, lon);
+    return true;
+}
+
+// builds header, operation, payload and checksum of one record
+static string make_record(ChangeLog::Operation op, const Tree & t) {
+    string body(1, (char)op);
+    body += encode(t);
+    string record;
+    put_u32(record, body.size() - 1);
+    record += body;
+    put_u32(record, crc32(body));
+    return record;
+}
+
+/* reads every intact record of path, calling apply on each one when apply is non-null
+ * returns the number of records read and sets good_bytes to the length of the intact prefix,
+ * or returns -1 if the file is missing or does not start with the magic
+ */
+static int scan(const string & path, const function<void(ChangeLog::Operation, const Tree &)> * apply,
+                long & good_bytes) {
+    ifstream in(path.c_str(), ios::binary);
+    char magic[sizeof(MAGIC)];
+    good_bytes = 0;
+    if (!in || !in.read(magic, sizeof(MAGIC)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+        return -1;
+    good_bytes = sizeof(MAGIC);
+
+    int count = 0;
+    string header(4, '\0'), body, trailer(4, '\0');
+    while (in.read(&header[0], 4)) {
+        size_t pos = 0;
+        unsigned int len = get_u32(header, pos);
+        if (len > MAX_PAYLOAD)
+            break;
+        body.resize(len + 1);
+        if (!in.read(&body[0], len + 1) || !in.read(&trailer[0], 4))
+            break;
+        pos = 0;
+        if (get_u32(trailer, pos) != crc32(body))
+            break;
+        char op = body[0];
+        Tree t;
+        if ((op != ChangeLog::ADD && op != ChangeLog::REMOVE) || !decode(body.substr(1), t))
+            break;
+        if (apply != nullptr)
+            (*apply)((ChangeLog::Operation)op, t);
+        good_bytes += 4 + len + 1 + 4;
+        count++;
+    }
+    return count;
+}
+
+// default constructor
+ChangeLog::ChangeLog():fd(-1), size(0), appended(0) {
+}
+
+// destructor
+ChangeLog::~ChangeLog() {
+    close();
+}
+
+/* opens the log for appending, cutting off a torn tail first
+ * only a missing or empty file is started afresh; a file without the magic is some other file,
+ * and is left as it is
+ */
+bool ChangeLog::open(const string & path) {
+    close();
+    struct stat info;
+    long good_bytes;
+    bool missing = stat(path.c_str(), &info) != 0;
+    if (missing && errno != ENOENT)
+        return false;
+    if (missing || info.st_size == 0) {
+        ofstream fresh(path.c_str(), ios::binary | ios::trunc);
+        if (!fresh.write(MAGIC, sizeof(MAGIC)))
+            return false;
+    }
+    else if (scan(path, nullptr, good_bytes) < 0) {
+        return false;
+    }
+    else if (truncate(path.c_str(), good_bytes) != 0) {
+        return false;
+    }
+    fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0)
+        return false;
+    size = lseek(fd, 0, SEEK_END);
+    log_path = path;
+    appended = 0;
+    return size >= 0;
+}
+
+// rewrites the log as just the magic, used once its records are in a snapshot
+bool ChangeLog::clear() {
+    string path = log_path;
+    close();
+    ofstream fresh(path.c_str(), ios::binary | ios::trunc);
+    if (!fresh.write(MAGIC, sizeof(MAGIC)))
+        return false;
+    fresh.close();
+    return open(path);
+}
+
+void ChangeLog::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool ChangeLog::is_open() const {
+    return fd >= 0;
+}
+
+const string & ChangeLog::path() const {
+    return log_path;
+}
+
+bool ChangeLog::append(Operation op, const Tree & t) {
+    return commit(make_record(op, t), 1);
+}
+
+bool ChangeLog::append(Operation op, const vector<const Tree *> & trees) {
+    string records;
+    for (size_t i = 0; i < trees.size(); i++)
+        records += make_record(op, *trees[i]);
+    return commit(records, trees.size());
+}
+
+/* writes the records and syncs them to the disk; if either fails, the file is cut back to
+ * where it was, so the records are all in the log or none are
+ */
+bool ChangeLog::commit(const string & records, int count) {
+    if (fd < 0)
+        return false;
+    size_t written = 0;
+    while (written < records.size()) {
+        ssize_t n = write(fd, records.data() + written, records.size() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        written += n;
+    }
+    if (written < records.size() || fdatasync(fd) != 0) {
+        if (ftruncate(fd, size) != 0) {      // the torn records would hide the ones after them
+            close();
+        }
+        return false;
+    }
+    size += records.size();
+    appended += count;
+    return true;
+}
+
+int ChangeLog::records() const {
+    return appended;
+}
+
+int ChangeLog::replay(const string & path,
+                      const function<void(Operation, const Tree &)> & apply) {
+    long good_bytes;
+    return scan(path, &apply, good_bytes);
+}
+
+// helper function to flush a file, or a directory's entries, to the disk
+static bool sync_path(const string & path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+/* writes every tree as an ADD record to a temporary file, then renames it over path
+ * the file is on the disk before the rename and the rename is on the disk before this returns, so the
+ * caller may empty the log afterwards without a crash losing both
+ */
+bool ChangeLog::write_snapshot(const string & path, const vector<const Tree *> & trees) {
+    string tmp_path = path + ".tmp";
+    ofstream fresh(tmp_path.c_str(), ios::binary | ios::trunc);
+    fresh.write(MAGIC, sizeof(MAGIC));
+    for (size_t i = 0; i < trees.size(); i++) {
+        string record = make_record(ADD, *trees[i]);
+        fresh.write(record.data(), record.size());
+    }
+    fresh.close();
+    if (!fresh || !sync_path(tmp_path))
+        return false;
+    if (rename(tmp_path.c_str(), path.c_str()) != 0)
+        return false;
+    size_t slash = path.rfind('/');
+    return sync_path(slash == string::npos ? "." : path.substr(0, slash + 1));
+}
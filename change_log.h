@@ -0,0 +1,129 @@
+/******************************************************************************
+Title : change_log.h
+Author : Yu Tong Chen
+Created on : 04/08/2019
+Description : The interface of ChangeLog, an append-only binary log of
+              add_tree and remove_tree operations.
+Usage : TreeCollection writes through it; see TreeCollection::open_log and
+        TreeCollection::apply_log.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef CHANGE_LOG_H
+#define CHANGE_LOG_H
+#include "tree_collection.h"
+#include <fstream>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+
+
+using namespace std;
+
+/******************************************************************************
+File Layout:
+ The file starts with the 8 byte magic "TREELOG1". It is followed by any
+ number of records, each laid out as
+
+  Bytes  Field
+  4      payload length n, little endian
+  1      operation: 'A' for add_tree, 'R' for remove_tree
+  n      the Tree: id, dbh and zip as 4 byte ints, status, health, name,
+         address and borough as 2 byte length + bytes, latitude and
+         longitude as 8 byte doubles
+  4      CRC-32 of the operation byte and the payload
+
+ A record whose length runs past the end of the file or whose checksum does
+ not match is a write torn by a crash. Reading stops there, and everything
+ before it is a consistent prefix of the history.
+ ******************************************************************************/
+
+class ChangeLog {
+    public:
+        enum Operation { ADD = 'A', REMOVE = 'R' };
+
+        ChangeLog();
+        ~ChangeLog();
+
+        /** open(path) opens path for appending, creating it if needed
+         *  A torn record left at the end by a crash is cut off first, so new
+         *  records always follow the last good one. A file that exists but
+         *  does not start with the magic is not a log and is not touched.
+         *  @param string path [in] the log file
+         *  @return bool true if the file could be opened as a log
+         */
+        bool open(const string & path);
+
+        /** clear() drops every record, leaving an empty log open
+         *  @return bool true if the log could be rewritten
+         */
+        bool clear();
+
+        /** close() closes the log */
+        void close();
+
+        bool is_open() const;
+
+        /** path() returns the file the log was opened on */
+        const string & path() const;
+
+        /** append(op,t) writes one record and syncs it to the disk
+         *  @notes
+         *       Once it returns true the record survives a power loss. If it
+         *       returns false the log is as it was before the call; should
+         *       even that fail, the log is closed, so no later record lands
+         *       after a torn one.
+         *  @param Operation op [in] ADD or REMOVE
+         *  @param Tree      t  [in] the tree the operation applies to
+         *  @return bool true if the record was written
+         */
+        bool append(Operation op, const Tree & t);
+
+        /** append(op,trees) writes one record per tree with a single sync,
+         *                   all of them or, on failure, none
+         *  @param Operation op [in] ADD or REMOVE
+         *  @param vector<const Tree*> trees [in] the trees, in order
+         *  @return bool true if the records were written
+         */
+        bool append(Operation op, const vector<const Tree *> & trees);
+
+        /** records() returns the number of records appended since open */
+        int records() const;
+
+        /** replay(path,apply) calls apply on every intact record of path
+         *  @param string path  [in] the log file
+         *  @param function apply [in] called with each operation and tree
+         *  @return int the number of records replayed, or -1 if path is not
+         *              a change log
+         */
+        static int replay(const string & path,
+                          const function<void(Operation, const Tree &)> & apply);
+
+        /** write_snapshot(path,trees) replaces path with one ADD per tree
+         *  The file is written under a temporary name, synced to the disk
+         *  and renamed over path, and the directory is synced, so a crash
+         *  leaves either the old or the new snapshot in place, and once it
+         *  returns true the new one survives a power loss.
+         *  @param string path  [in] the snapshot file
+         *  @param vector<const Tree*> trees [in] the trees to store, in order
+         *  @return bool true if the snapshot was written
+         */
+        static bool write_snapshot(const string & path,
+                                   const vector<const Tree *> & trees);
+
+    private:
+        string   log_path;
+        int      fd;          // open for appending, or -1
+        off_t    size;        // bytes of the file, all of them whole records
+        int      appended;
+
+        bool commit(const string & records, int count);
+
+        ChangeLog(const ChangeLog &);
+        ChangeLog & operator=(const ChangeLog &);
+};
+
+
+#endif //CHANGE_LOG_H
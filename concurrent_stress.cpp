@@ -0,0 +1,154 @@
+/******************************************************************************
+Title : concurrent_stress.cpp
+Author : Yu Tong Chen
+Created on : 04/02/2019
+Description : A stress test of ConcurrentTreeCollection: writer threads add
+              and remove trees while reader threads check that every pinned
+              version is consistent with itself, and that it holds every
+              change finished before pin() and none begun after it.
+Usage : make stress && build/stress [rounds]
+Build with : Makefile (needs -pthread; built with -fsanitize=thread)
+Modifications:
+
+******************************************************************************/
+
+#include "concurrent_tree_collection.h"
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+static const int WRITERS = 2;
+static const int READERS = 4;
+static const int BATCH   = 64;      // trees a writer adds before removing half of them
+
+// writer w's trees take the species w, w + WRITERS, ..., so a version's count of them is its count of w's
+static const string SPECIES[] = { "pin oak", "London planetree", "honeylocust", "Callery pear" };
+static const int    SPECIES_COUNT = sizeof(SPECIES) / sizeof(SPECIES[0]);
+static const int    ROUND_OPS = BATCH + BATCH / 2;   // add_tree and remove_tree calls of one round
+
+static atomic<int>  failures(0);
+static atomic<bool> writing(true);
+static atomic<int>  started[WRITERS];     // changes each writer has begun
+static atomic<int>  finished[WRITERS];    // and has seen return
+
+static void fail(const char *what, int expected, int found) {
+    if (failures++ < 10)
+        cerr << "stress: " << what << ": expected " << expected << ", found " << found << endl;
+}
+
+/* writer w owns the ids w, w + WRITERS, w + 2 * WRITERS, ...; each round it adds a batch of
+ * trees spread over its species and the boroughs, then removes every other one of them. Each
+ * change is counted in started before it is made and in finished once it has returned
+ */
+static void write_trees(ConcurrentTreeCollection & trees, int w, int rounds) {
+    int next = w;
+    for (int r = 0; r < rounds; r++) {
+        vector<Tree> added;
+        for (int i = 0; i < BATCH; i++, next += WRITERS) {
+            const string & species = SPECIES[w + WRITERS * (next / WRITERS % (SPECIES_COUNT / WRITERS))];
+            Tree t(next, next % 40, "Alive", "Good", species,
+                   10000 + next % 300, "", BOROUGH_NAMES[next % BOROUGHS], 40.7, -73.9);
+            started[w]++;
+            if (trees.add_tree(t) != 1)
+                fail("add_tree of a new id", 1, 0);
+            finished[w]++;
+            added.push_back(t);
+        }
+        for (size_t i = 0; i < added.size(); i += 2) {
+            started[w]++;
+            if (trees.remove_tree(added[i]) != 1)
+                fail("remove_tree of a present tree", 1, 0);
+            finished[w]++;
+        }
+    }
+}
+
+/* the trees a writer holds once it has made the given number of changes: BATCH / 2 per whole
+ * round, plus the adds of the round it is in, less its removes
+ */
+static int trees_after(int changes) {
+    int in_round = changes % ROUND_OPS;
+    int kept = (changes / ROUND_OPS) * (BATCH / 2);
+    return kept + (in_round <= BATCH ? in_round : 2 * BATCH - in_round);
+}
+
+/* every count a version gives must agree with the others from the same version: a species'
+ * borough counts add up to its total, and the species totals and the borough totals each add
+ * up to the tree count. The version must also fall at a real point in time: each writer's trees
+ * in it must be what it had after some number of changes between those finished before pin()
+ * was called and those started by the time it returned
+ */
+static void check_versions(const ConcurrentTreeCollection & trees, int & checked) {
+    boro counts[BOROUGHS];
+    int done[WRITERS], begun[WRITERS];
+    while (writing.load()) {
+        for (int w = 0; w < WRITERS; w++)
+            done[w] = finished[w].load();
+        ConcurrentTreeCollection::Version v = trees.pin();
+        for (int w = 0; w < WRITERS; w++)
+            begun[w] = started[w].load();
+        for (int w = 0; w < WRITERS; w++) {
+            int mine = 0;
+            for (int s = w; s < SPECIES_COUNT; s += WRITERS)
+                mine += v.count_of_tree_species(SPECIES[s]);
+            int p = done[w];
+            while (p <= begun[w] && trees_after(p) != mine)
+                p++;
+            if (p > begun[w])
+                fail("a writer's trees, as of no time during pin()", trees_after(done[w]), mine);
+        }
+        int total = v.total_tree_count();
+        int by_species = 0;
+        for (int s = 0; s < SPECIES_COUNT; s++) {
+            int count = v.count_of_tree_species(SPECIES[s]);
+            int by_boro = v.get_counts_of_trees_by_boro(SPECIES[s], counts);
+            if (by_boro != count)
+                fail("borough counts of a species", count, by_boro);
+            int in_boro = 0;
+            for (int b = 0; b < BOROUGHS; b++)
+                in_boro += v.count_of_tree_species_in_boro(SPECIES[s], BOROUGH_NAMES[b]);
+            if (in_boro != count)
+                fail("count_of_tree_species_in_boro over the boroughs", count, in_boro);
+            by_species += count;
+        }
+        if (by_species != total)
+            fail("species counts", total, by_species);
+        int by_boro = 0;
+        for (int b = 0; b < BOROUGHS; b++)
+            by_boro += v.count_of_trees_in_boro(BOROUGH_NAMES[b]);
+        if (by_boro != total)
+            fail("borough counts", total, by_boro);
+        checked++;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = (argc > 1) ? atoi(argv[1]) : 50;
+    ConcurrentTreeCollection trees;
+
+    vector<int> checked(READERS, 0);
+    vector<thread> readers;
+    for (int i = 0; i < READERS; i++)
+        readers.push_back(thread(check_versions, cref(trees), ref(checked[i])));
+    vector<thread> writers;
+    for (int w = 0; w < WRITERS; w++)
+        writers.push_back(thread(write_trees, ref(trees), w, rounds));
+    for (size_t i = 0; i < writers.size(); i++)
+        writers[i].join();
+    writing = false;
+    for (size_t i = 0; i < readers.size(); i++)
+        readers[i].join();
+
+    int expected = WRITERS * rounds * (BATCH / 2);
+    if (trees.total_tree_count() != expected)
+        fail("trees left", expected, trees.total_tree_count());
+    int versions = 0;
+    for (int i = 0; i < READERS; i++)
+        versions += checked[i];
+    cout << versions << " versions checked, " << failures.load() << " failures" << endl;
+    return failures.load() == 0 ? 0 : 1;
+}
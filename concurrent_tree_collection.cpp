@@ -0,0 +1,167 @@
+/******************************************************************************
+Title : concurrent_tree_collection.cpp
+Author : Yu Tong Chen
+Created on : 04/02/2019
+Description : The implementation of concurrent_tree_collection.
+Usage :
+Build with : Makefile (needs -pthread)
+Modifications:
+
+******************************************************************************/
+
+#include "concurrent_tree_collection.h"
+#include "species_dictionary.h"
+
+double haversine(double lat1, double lon1, double lat2, double lon2);  // tree_collection.cpp
+
+// default constructor
+ConcurrentTreeCollection::ConcurrentTreeCollection() {
+}
+
+// destructor
+ConcurrentTreeCollection::~ConcurrentTreeCollection() {
+}
+
+ConcurrentTreeCollection::Version ConcurrentTreeCollection::pin() const {
+    return Version(*this);
+}
+
+int ConcurrentTreeCollection::total_tree_count() {
+    return pin().total_tree_count();
+}
+
+int ConcurrentTreeCollection::count_of_tree_species ( const string & species_name ) {
+    return pin().count_of_tree_species(species_name);
+}
+
+int ConcurrentTreeCollection::count_of_tree_species_in_boro ( const string & species_name,
+                                    const string & boro_name ) {
+    return pin().count_of_tree_species_in_boro(species_name, boro_name);
+}
+
+int ConcurrentTreeCollection::get_counts_of_trees_by_boro ( const string & species_name,
+                                  boro  tree_count[5] ) {
+    return pin().get_counts_of_trees_by_boro(species_name, tree_count);
+}
+
+int ConcurrentTreeCollection::count_of_trees_in_boro( const string & boro_name ) {
+    return pin().count_of_trees_in_boro(boro_name);
+}
+
+int ConcurrentTreeCollection::add_tree( Tree & new_tree) {
+    return trees.insert(new_tree) ? 1 : 0;
+}
+
+int ConcurrentTreeCollection::remove_tree( const Tree & old_tree) {
+    return trees.remove(old_tree) ? 1 : 0;
+}
+
+void ConcurrentTreeCollection::print_all_species(ostream & out) const {
+    set<string> all_species;
+    trees.for_each([&](const Tree & t) {
+        all_species.insert(t.common_name());
+    });
+    for (auto &i : all_species)
+        out << i << endl;
+}
+
+void ConcurrentTreeCollection::print(ostream & out ) const {
+    trees.for_each([&](const Tree & t) {
+        out << t << endl;
+    });
+}
+
+list<string> ConcurrentTreeCollection::get_matching_species(const string & species_name) const {
+    string partial = SpeciesDictionary::fold(species_name);
+    set<string> matches;
+    trees.for_each([&](const Tree & t) {
+        string name = SpeciesDictionary::fold(t.common_name());
+        if (name.find(partial) != string::npos)
+            matches.insert(name);
+    });
+    return list<string>(matches.begin(), matches.end());
+}
+
+list<string> ConcurrentTreeCollection::get_all_in_zipcode(int zipcode) const {
+    set<string> species_zipcode;
+    trees.for_each([&](const Tree & t) {
+        if (t.zip_code() == zipcode)
+            species_zipcode.insert(SpeciesDictionary::fold(t.common_name()));
+    });
+    return list<string>(species_zipcode.begin(), species_zipcode.end());
+}
+
+list<string> ConcurrentTreeCollection::get_all_near(double latitude, double longitude,
+                          double  distance) const {
+    set<string> species_within;
+    trees.for_each([&](const Tree & t) {
+        double lat, lon;
+        t.get_position(lat, lon);
+        if (haversine(lat, lon, latitude, longitude) <= distance)
+            species_within.insert(t.common_name());
+    });
+    return list<string>(species_within.begin(), species_within.end());
+}
+
+ConcurrentTreeCollection::Version::Version(const ConcurrentTreeCollection & collection)
+    :trees(collection.trees), reader(collection.trees) {
+}
+
+// size is kept in every node, so this is one load of the pinned root
+int ConcurrentTreeCollection::Version::total_tree_count() const {
+    return trees.size(reader);
+}
+
+int ConcurrentTreeCollection::Version::count_of_tree_species(const string & species_name) const {
+    string name = SpeciesDictionary::fold(species_name);
+    int count = 0;
+    trees.for_each(reader, [&](const Tree & t) {
+        if (SpeciesDictionary::folds_to(t.common_name(), name))
+            count++;
+    });
+    return count;
+}
+
+int ConcurrentTreeCollection::Version::count_of_tree_species_in_boro(const string & species_name,
+                                                                     const string & boro_name) const {
+    Borough b = borough_named(boro_name);
+    if (b == BOROUGHS)
+        return 0;
+    string name = SpeciesDictionary::fold(species_name);
+    int count = 0;
+    trees.for_each(reader, [&](const Tree & t) {
+        if (t.borough() == b && SpeciesDictionary::folds_to(t.common_name(), name))
+            count++;
+    });
+    return count;
+}
+
+// all five counts come from the same version, so they always add up to the total
+int ConcurrentTreeCollection::Version::get_counts_of_trees_by_boro(const string & species_name,
+                                                                   boro tree_count[5]) const {
+    string name = SpeciesDictionary::fold(species_name);
+    for (int i = 0; i < BOROUGHS; i++) {
+        tree_count[i].name = BOROUGH_NAMES[i];
+        tree_count[i].count = 0;
+    }
+    int total_count = 0;
+    trees.for_each(reader, [&](const Tree & t) {
+        if (t.borough() != BOROUGHS && SpeciesDictionary::folds_to(t.common_name(), name)) {
+            tree_count[t.borough()].count++;
+            total_count++;
+        }
+    });
+    return total_count;
+}
+
+int ConcurrentTreeCollection::Version::count_of_trees_in_boro(const string & boro_name) const {
+    Borough b = borough_named(boro_name);
+    if (b == BOROUGHS)
+        return 0;
+    int count = 0;
+    trees.for_each(reader, [&](const Tree & t) {
+        if (t.borough() == b)
+            count++;
+    });
+    return count;
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+Title : concurrent_tree_collection.h
+Author : Yu Tong Chen
+Created on : 04/02/2019
+Description : The interface of ConcurrentTreeCollection, a derived class of
+              __tree_collection that can be queried while trees are added.
+Usage : Use in place of TreeCollection when one thread feeds add_tree while
+        others run queries.
+Build with : Makefile (needs -pthread)
+Modifications:
+
+******************************************************************************/
+
+#ifndef CONCURRENT_TREE_COLLECTION_H
+#define CONCURRENT_TREE_COLLECTION_H
+#include "tree_collection.h"
+#include "ConcurrentAvlTree.h"
+#include <set>
+
+
+using namespace std;
+
+/** class ConcurrentTreeCollection
+ *  Stores the trees in a ConcurrentAvlTree. Every query pins one published
+ *  version of the tree and answers entirely from it, so a query never
+ *  blocks and never sees a half-applied add_tree. Writers are serialized
+ *  inside the ConcurrentAvlTree.
+ */
+class ConcurrentTreeCollection:public __TreeCollection {
+    public:
+        /** class Version
+         *  One published version of the collection, pinned for the life of
+         *  the object. Its queries all read that version, so they agree with
+         *  each other: the borough counts of a species add up to its total,
+         *  and the species totals to the tree count, while add_tree and
+         *  remove_tree go on in other threads. Nodes a writer replaces are
+         *  not freed while a Version still pins them, so keep it short-lived.
+         */
+        class Version {
+            public:
+                explicit Version(const ConcurrentTreeCollection & collection);
+
+                int total_tree_count() const;
+                int count_of_tree_species(const string & species_name) const;
+                int count_of_tree_species_in_boro(const string & species_name,
+                                                  const string & boro_name) const;
+                int get_counts_of_trees_by_boro(const string & species_name,
+                                                boro tree_count[5]) const;
+                int count_of_trees_in_boro(const string & boro_name) const;
+
+            private:
+                const ConcurrentAvlTree<Tree> &  trees;
+                ConcurrentAvlTree<Tree>::Reader  reader;
+        };
+
+        ConcurrentTreeCollection();
+        ~ConcurrentTreeCollection();
+
+        /** pin() returns the current version, for queries whose answers must
+         *        agree; each query below pins a version of its own
+         */
+        Version pin() const;
+
+        /** total_tree_count() returns total number of trees in data set
+         *  @return int count of trees in the current version
+         */
+        int total_tree_count() override;
+
+        /** count_of_tree_species(s) returns number of trees with name s
+         * @param  string species_name [in] species name to search for
+         * @return int the number of trees that have the given species name
+         */
+        int count_of_tree_species ( const string & species_name ) override;
+
+        /** count_of_tree_species_in_boro(s,b) returns number of trees with name s
+         *                                     in boro b
+         * @param  string species_name [in] species name to search for
+         * @param  string boro_name [in] species borough to look in
+         * @return int the number of trees in boro that have the given species name
+         */
+        int count_of_tree_species_in_boro ( const string & species_name,
+                                            const string & boro_name ) override;
+
+        /** get_counts_of_trees_by_boro(s,t) puts number of trees matching name s
+         *                                     in all boros into param t
+         * @param  string species_name [in] species name to search for
+         * @param  boro boro_name[5] [in,out] array of boro structures
+         * @return int the total number of trees of given species in all boros
+         */
+        int get_counts_of_trees_by_boro ( const string & species_name,
+                                           boro  tree_count[5] ) override;
+
+        /** count_of_trees_in_boro(b) returns number of trees of all types in boro b
+         * @param  string boro_name [in] species borough to look in
+         * @return int the number of trees in boro boro_name
+         */
+        int count_of_trees_in_boro( const string & boro_name ) override;
+
+        /** add_tree(t) publishes a new version containing Tree t
+         * @param Tree new_tree [in] the tree to be inserted
+         * @return int the number of trees inserted: 0 if none, 1 if inserted
+         */
+        int add_tree( Tree & new_tree) override;
+
+        /** remove_tree(t) publishes a new version without Tree t
+         * @param Tree old_tree [in] the tree to be removed
+         * @return int the number of trees removed: 0 if none, 1 if removed
+         */
+        int remove_tree( const Tree & old_tree);
+
+        void print_all_species(ostream & out) const override;
+        void print(ostream & out ) const override;
+        list<string> get_matching_species(
+                               const string & species_name) const override;
+        list<string> get_all_in_zipcode(int zipcode) const override;
+        list<string> get_all_near(double latitude, double longitude,
+                             double  distance) const override;
+
+    private:
+        ConcurrentAvlTree<Tree> trees;  // every query reads one published version
+};
+
+
+#endif //CONCURRENT_TREE_COLLECTION_H
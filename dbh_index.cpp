@@ -0,0 +1,164 @@
+/******************************************************************************
+Title : dbh_index.cpp
+Author : Yu Tong Chen
+Created on : 04/29/2019
+Description : The implementation of dbh_index.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "tree_collection.h"
+#include "dbh_index.h"
+#include <cmath>
+
+DbhIndex::Fenwick::Fenwick():counts(DBH_BUCKETS + 1, 0) {
+}
+
+void DbhIndex::Fenwick::add(int bucket, int delta) {
+    for (int i = bucket + 1; i <= DBH_BUCKETS; i += i & -i)
+        counts[i] += delta;
+}
+
+int DbhIndex::Fenwick::prefix(int bucket) const {
+    int sum = 0;
+    for (int i = bucket + 1; i > 0; i -= i & -i)
+        sum += counts[i];
+    return sum;
+}
+
+int DbhIndex::Fenwick::total() const {
+    return prefix(DBH_BUCKETS - 1);
+}
+
+// descends by powers of two, skipping every block whose count is still below k
+int DbhIndex::Fenwick::kth(int k) const {
+    int pos = 0;
+    for (int step = DBH_BUCKETS; step > 0; step >>= 1) {
+        if (pos + step <= DBH_BUCKETS && counts[pos + step] < k) {
+            pos += step;
+            k -= counts[pos];
+        }
+    }
+    return pos;    // pos + 1 in the 1-based layout, so bucket pos
+}
+
+// default constructor
+DbhIndex::DbhIndex():lists((BOROUGHS + 1) * DBH_BUCKETS) {
+}
+
+int DbhIndex::bucket_of(int dbh) {
+    if (dbh < 0)
+        return 0;
+    return dbh < DBH_BUCKETS ? dbh : DBH_BUCKETS - 1;
+}
+
+vector<int> & DbhIndex::list_of(int borough, int bucket) {
+    return lists[borough * DBH_BUCKETS + bucket];
+}
+
+const vector<int> & DbhIndex::list_of(int borough, int bucket) const {
+    return lists[borough * DBH_BUCKETS + bucket];
+}
+
+void DbhIndex::insert(int slot, const Tree & t, int species) {
+    if (slot >= (int)slot_bucket.size()) {
+        slot_bucket.resize(slot + 1, -1);
+        slot_position.resize(slot + 1, 0);
+        slot_borough.resize(slot + 1, BOROUGHS);
+        slot_species.resize(slot + 1, 0);
+    }
+    if (species >= (int)species_codes.size())
+        species_codes.resize(species + 1, -1);
+    int code = species_codes[species];
+    if (code < 0) {
+        code = species_codes[species] = by_species.size();
+        by_species.push_back(Fenwick());
+    }
+
+    int bucket = bucket_of(t.diameter());
+    Borough b = t.borough();
+    vector<int> & list = list_of(b, bucket);
+    slot_bucket[slot] = bucket;
+    slot_position[slot] = list.size();
+    slot_borough[slot] = b;
+    slot_species[slot] = code;
+    list.push_back(slot);
+
+    all.add(bucket, 1);
+    if (b != BOROUGHS)
+        by_borough[b].add(bucket, 1);
+    by_species[code].add(bucket, 1);
+}
+
+// the last slot of the list takes the place of the one removed
+void DbhIndex::remove(int slot) {
+    if (slot >= (int)slot_bucket.size() || slot_bucket[slot] < 0)
+        return;
+    int bucket = slot_bucket[slot];
+    int b = slot_borough[slot];
+    vector<int> & list = list_of(b, bucket);
+    int moved = list.back();
+    list[slot_position[slot]] = moved;
+    slot_position[moved] = slot_position[slot];
+    list.pop_back();
+    slot_bucket[slot] = -1;
+
+    all.add(bucket, -1);
+    if (b != BOROUGHS)
+        by_borough[b].add(bucket, -1);
+    by_species[slot_species[slot]].add(bucket, -1);
+}
+
+void DbhIndex::clear() {
+    all = Fenwick();
+    for (int b = 0; b < BOROUGHS; b++)
+        by_borough[b] = Fenwick();
+    by_species.clear();
+    species_codes.clear();
+    for (size_t i = 0; i < lists.size(); i++)
+        lists[i].clear();
+    slot_bucket.clear();
+    slot_position.clear();
+    slot_borough.clear();
+    slot_species.clear();
+}
+
+int DbhIndex::count(int lo, int hi, Borough b) const {
+    if (lo > hi || hi < 0)
+        return 0;
+    const Fenwick & f = (b == BOROUGHS) ? all : by_borough[b];
+    int below = (lo <= 0) ? 0 : f.prefix(bucket_of(lo - 1));
+    if (lo >= DBH_BUCKETS)     // only the shared last bucket can hold such trees
+        below = f.prefix(DBH_BUCKETS - 2);
+    return f.prefix(bucket_of(hi)) - below;
+}
+
+void DbhIndex::slots(int lo, int hi, Borough b, vector<int> & out) const {
+    if (lo > hi || hi < 0)
+        return;
+    for (int bucket = bucket_of(lo); bucket <= bucket_of(hi); bucket++) {
+        for (int row = 0; row <= BOROUGHS; row++) {
+            if (b != BOROUGHS && row != b)
+                continue;
+            const vector<int> & list = list_of(row, bucket);
+            out.insert(out.end(), list.begin(), list.end());
+        }
+    }
+}
+
+int DbhIndex::quantile(double q, int species) const {
+    const Fenwick *f = &all;
+    if (species >= 0) {
+        if (species >= (int)species_codes.size() || species_codes[species] < 0)
+            return -1;
+        f = &by_species[species_codes[species]];
+    }
+    int n = f->total();
+    if (n == 0)
+        return -1;
+    q = (q < 0) ? 0 : (q > 1) ? 1 : q;
+    int k = (int)ceil(q * n);
+    return f->kth(k < 1 ? 1 : k);
+}
@@ -0,0 +1,110 @@
+/******************************************************************************
+Title : dbh_index.h
+Author : Yu Tong Chen
+Created on : 04/29/2019
+Description : The interface of DbhIndex, a secondary index that orders the
+              stored trees by diameter (tree_dbh).
+Usage : Maintained by TreeCollection::add_tree and remove_tree; queried
+        through count_in_dbh_range, get_all_in_dbh_range and dbh_quantile.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef DBH_INDEX_H
+#define DBH_INDEX_H
+#include "tree_schema.h"
+#include <vector>
+
+
+using namespace std;
+
+class Tree;
+
+/** class DbhIndex
+ *  Diameters are whole inches, so the index keeps one bucket per inch.
+ *  Fenwick trees over the buckets count the trees in every borough and of
+ *  every species, which makes a range count or a quantile O(log buckets).
+ *  Each bucket also lists its slots per borough, so a range is enumerated
+ *  in time proportional to what it holds.
+ */
+class DbhIndex {
+    public:
+        // diameters of DBH_BUCKETS - 1 inches or more share the last bucket
+        static const int DBH_BUCKETS = 1024;
+
+        DbhIndex();
+
+        /** insert(slot,t,s) adds the tree t stored at slot
+         *  @param int  slot    [in] the slot t is stored in; not already in the index
+         *  @param Tree t       [in] the tree
+         *  @param int  species [in] the folded_id of t's species in the
+         *                           collection's SpeciesDictionary
+         */
+        void insert(int slot, const Tree & t, int species);
+
+        /** remove(slot) removes the tree stored at slot, if it is indexed */
+        void remove(int slot);
+
+        /** clear() removes every tree */
+        void clear();
+
+        /** count(lo,hi,b) returns the number of trees with lo <= dbh <= hi
+         *  @param int     lo [in] the smallest diameter
+         *  @param int     hi [in] the largest diameter
+         *  @param Borough b  [in] the borough to count in, or BOROUGHS for all
+         *  @return int the number of trees
+         */
+        int count(int lo, int hi, Borough b = BOROUGHS) const;
+
+        /** slots(lo,hi,b,out) appends the slots of the trees with lo <= dbh <= hi
+         *                     to out, in order of increasing dbh
+         *  @param int         lo  [in]  the smallest diameter
+         *  @param int         hi  [in]  the largest diameter
+         *  @param Borough     b   [in]  the borough to look in, or BOROUGHS for all
+         *  @param vector<int> out [out] the slots
+         */
+        void slots(int lo, int hi, Borough b, vector<int> & out) const;
+
+        /** quantile(q,s) returns the nearest-rank q-quantile of the diameters
+         *  of species s
+         *  @param double q       [in] between 0 and 1; 0.5 is the median
+         *  @param int    species [in] a folded_id, as given to insert; -1 for
+         *                             all trees
+         *  @return int the diameter, or -1 if there are no such trees
+         */
+        int quantile(double q, int species = -1) const;
+
+    private:
+        /** class Fenwick
+         *  Counts per bucket, with prefix sums and rank search in O(log n)
+         */
+        class Fenwick {
+            public:
+                Fenwick();
+                void add(int bucket, int delta);
+                int  prefix(int bucket) const;   // trees in buckets 0..bucket
+                int  total() const;
+                int  kth(int k) const;           // bucket of the k-th smallest, 1-based
+            private:
+                vector<int> counts;              // 1-based Fenwick layout
+        };
+
+        Fenwick         all;
+        Fenwick         by_borough[BOROUGHS];
+        vector<Fenwick> by_species;              // by code from species_codes
+        vector<int>     species_codes;           // code of each folded_id, or -1
+
+        vector<vector<int> > lists;     // slots of (borough, bucket), BOROUGHS + 1 rows
+        vector<int>           slot_bucket;       // -1 if the slot is not indexed
+        vector<int>           slot_position;     // where the slot is in its list
+        vector<unsigned char> slot_borough;
+        vector<int>           slot_species;
+
+        static int bucket_of(int dbh);
+        vector<int> & list_of(int borough, int bucket);
+        const vector<int> & list_of(int borough, int bucket) const;
+};
+
+
+#endif //DBH_INDEX_H
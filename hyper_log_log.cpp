@@ -0,0 +1,53 @@
+/******************************************************************************
+Title : hyper_log_log.cpp
+Author : Yu Tong Chen
+Created on : 05/05/2019
+Description : The implementation of hyper_log_log.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "hyper_log_log.h"
+#include <cmath>
+
+// default constructor
+HyperLogLog::HyperLogLog():registers(REGISTERS, 0) {
+}
+
+// the values are small ids, so they are mixed (splitmix64) before their bits are used
+void HyperLogLog::add(uint64_t value) {
+    uint64_t h = value + 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+
+    int index = h >> (64 - PRECISION);
+    uint64_t rest = (h << PRECISION) | (1ULL << (PRECISION - 1));    // the guard bit caps the rank
+    uint8_t rank = __builtin_clzll(rest) + 1;
+    if (rank > registers[index])
+        registers[index] = rank;
+}
+
+/* the harmonic mean of 2^register, scaled by the bias constant for this many registers
+ * while many registers are still zero, linear counting is more accurate and is used instead
+ */
+double HyperLogLog::estimate() const {
+    const double m = REGISTERS;
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    double sum = 0;
+    int zeroes = 0;
+    for (int i = 0; i < REGISTERS; i++) {
+        sum += ldexp(1.0, -registers[i]);
+        zeroes += (registers[i] == 0);
+    }
+    double raw = alpha * m * m / sum;
+    if (raw <= 2.5 * m && zeroes > 0)
+        return m * log(m / zeroes);
+    return raw;
+}
+
+void HyperLogLog::clear() {
+    registers.assign(REGISTERS, 0);
+}
@@ -0,0 +1,43 @@
+/******************************************************************************
+Title : hyper_log_log.h
+Author : Yu Tong Chen
+Created on : 05/05/2019
+Description : The interface of HyperLogLog, a fixed-size sketch that
+              estimates how many distinct values it has been given.
+Usage : add(value) for every value, then estimate().
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef HYPER_LOG_LOG_H
+#define HYPER_LOG_LOG_H
+#include <cstdint>
+#include <vector>
+
+
+using namespace std;
+
+/** class HyperLogLog
+ *  Each value is hashed; the top PRECISION bits pick a register, which
+ *  keeps the longest run of leading zeroes seen in the rest. With 4096
+ *  registers the estimate is usually within 2% (1.04 / sqrt(4096)), in
+ *  4 KB no matter how many values are added.
+ */
+class HyperLogLog {
+    public:
+        static const int PRECISION = 12;
+        static const int REGISTERS = 1 << PRECISION;
+
+        HyperLogLog();
+
+        void   add(uint64_t value);
+        double estimate() const;
+        void   clear();
+
+    private:
+        vector<uint8_t> registers;
+};
+
+
+#endif //HYPER_LOG_LOG_H
@@ -0,0 +1,110 @@
+/******************************************************************************
+Title : settle_stress.cpp
+Author : Yu Tong Chen
+Created on : 05/30/2019
+Description : A stress test of the settle step of AvlTree, BPlusTree and
+              ZOrderIndex: items are staged by bulk inserts, then several
+              threads query the same structure at once, so they race to be
+              the one that places the staged items. Every query must see all
+              of them, and the structure must be whole afterwards.
+Usage : make settle && build/settle [rounds]
+Build with : Makefile (needs -pthread; built with -fsanitize=thread)
+Modifications:
+
+******************************************************************************/
+
+#include "AvlTree.h"
+#include "BPlusTree.h"
+#include "zorder_index.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+static const int THREADS = 4;
+static const int ITEMS   = 20000;     // items staged before each round of queries
+static const int SIDE    = 100;       // points in a row of the ZOrderIndex grid
+
+static atomic<int> failures(0);
+
+static void fail(const char *what, int expected, int found) {
+    if (failures++ < 10)
+        cerr << "settle: " << what << ": expected " << expected << ", found " << found << endl;
+}
+
+// stages ITEMS ints in a scattered order, has every thread find its share of them, then ends the bulk load
+template <class Tree>
+static void settle_tree(const char *name, int rounds) {
+    for (int r = 0; r < rounds; r++) {
+        Tree tree(-1);
+        tree.begin_bulk();
+        for (int i = 0; i < ITEMS; i++)
+            tree.insert((int)((i * 7919LL) % ITEMS));
+
+        vector<int> found(THREADS, 0);
+        vector<thread> threads;
+        for (int k = 0; k < THREADS; k++)
+            threads.push_back(thread([&tree, &found, k]() {
+                for (int i = k; i < ITEMS; i += THREADS)
+                    found[k] += (tree.find(i) == i);
+            }));
+        for (size_t k = 0; k < threads.size(); k++)
+            threads[k].join();
+        int total = 0;
+        for (int k = 0; k < THREADS; k++)
+            total += found[k];
+        if (total != ITEMS)
+            fail(name, ITEMS, total);
+
+        tree.end_bulk();
+        Tree copy(tree);
+        if (copy.isEmpty() || copy.findMax() != ITEMS - 1)
+            fail(name, ITEMS - 1, copy.isEmpty() ? -1 : copy.findMax());
+    }
+}
+
+// indexes ITEMS points on a grid, then has every thread look up a box around each of its share of them
+static void settle_zorder(int rounds) {
+    for (int r = 0; r < rounds; r++) {
+        ZOrderIndex index;
+        for (int i = 0; i < ITEMS; i++)
+            index.insert(i, 40.5 + (i / SIDE) * 0.001, -74.2 + (i % SIDE) * 0.001);
+
+        vector<int> found(THREADS, 0);
+        vector<thread> threads;
+        for (int k = 0; k < THREADS; k++)
+            threads.push_back(thread([&index, &found, k]() {
+                vector<int> slots;
+                for (int i = k; i < ITEMS; i += THREADS * 50) {
+                    double latitude = 40.5 + (i / SIDE) * 0.001, longitude = -74.2 + (i % SIDE) * 0.001;
+                    index.in_box(latitude - 0.0004, longitude - 0.0004,
+                                 latitude + 0.0004, longitude + 0.0004, slots);
+                    found[k] += (slots.size() == 1 && slots[0] == i);
+                }
+            }));
+        for (size_t k = 0; k < threads.size(); k++)
+            threads[k].join();
+        int total = 0, expected = 0;
+        for (int k = 0; k < THREADS; k++) {
+            total += found[k];
+            expected += (ITEMS - k + THREADS * 50 - 1) / (THREADS * 50);
+        }
+        if (total != expected)
+            fail("ZOrderIndex", expected, total);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = (argc > 1) ? atoi(argv[1]) : 20;
+
+    settle_tree<AvlTree<int> >("AvlTree", rounds);
+    settle_tree<BPlusTree<int> >("BPlusTree", rounds);
+    settle_zorder(rounds);
+
+    cout << rounds << " rounds of each, " << failures.load() << " failures" << endl;
+    return failures.load() == 0 ? 0 : 1;
+}
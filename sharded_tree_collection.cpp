@@ -0,0 +1,208 @@
+/******************************************************************************
+Title : sharded_tree_collection.cpp
+Author : Yu Tong Chen
+Created on : 05/14/2019
+Description : The implementation of sharded_tree_collection.
+Usage :
+Build with : Makefile (needs -pthread)
+Modifications:
+
+******************************************************************************/
+
+#include "sharded_tree_collection.h"
+#include <algorithm>
+#include <queue>
+
+// constructor
+ShardedTreeCollection::ShardedTreeCollection(int threads):pool(threads) {
+}
+
+// destructor
+ShardedTreeCollection::~ShardedTreeCollection() {
+}
+
+// every shard counts, the one without a borough included, as in count_of_tree_species and print
+int ShardedTreeCollection::total_tree_count() {
+    int count = 0;
+    for (int s = 0; s < SHARDS; s++)
+        count += shards[s].total_tree_count();
+    return count;
+}
+
+int ShardedTreeCollection::count_of_tree_species ( const string & species_name ) {
+    int counts[SHARDS];
+    pool.run(SHARDS, [&](int s) {
+        counts[s] = species_count(s, species_name);
+    });
+    int count = 0;
+    for (int s = 0; s < SHARDS; s++)
+        count += counts[s];
+    return count;
+}
+
+int ShardedTreeCollection::count_of_tree_species_in_boro ( const string & species_name,
+                                    const string & boro_name ) {
+    Borough b = borough_named(boro_name);
+    if (b == BOROUGHS)
+        return 0;
+    return species_count(b, species_name);
+}
+
+int ShardedTreeCollection::get_counts_of_trees_by_boro ( const string & species_name,
+                                  boro  tree_count[5] ) {
+    pool.run(BOROUGHS, [&](int b) {
+        tree_count[b].name = BOROUGH_NAMES[b];
+        tree_count[b].count = species_count(b, species_name);
+    });
+    int total_count = 0;
+    for (int b = 0; b < BOROUGHS; b++)
+        total_count += tree_count[b].count;
+    return total_count;
+}
+
+int ShardedTreeCollection::count_of_trees_in_boro( const string & boro_name ) {
+    Borough b = borough_named(boro_name);
+    return b == BOROUGHS ? 0 : shards[b].count_of_trees_in_boro(boro_name);
+}
+
+int ShardedTreeCollection::add_tree( Tree & new_tree) {
+    if (shard_of_id.find(new_tree.id()) >= 0)
+        return 0;
+    int s = new_tree.borough();
+    if (shards[s].add_tree(new_tree) == 0)
+        return 0;
+    shard_of_id.insert(new_tree.id(), s);
+    return 1;
+}
+
+// the shard is found by id, since old_tree only needs to carry the key
+int ShardedTreeCollection::remove_tree( const Tree & old_tree) {
+    int s = shard_of_id.find(old_tree.id());
+    if (s < 0 || shards[s].remove_tree(old_tree) == 0)
+        return 0;
+    shard_of_id.erase(old_tree.id());
+    return 1;
+}
+
+void ShardedTreeCollection::print_all_species(ostream & out) const {
+    vector<list<string> > names(SHARDS);
+    pool.run(SHARDS, [&](int s) {
+        vector<int> ids;
+        shards[s].get_matching_species("", ids);
+        for (size_t i = 0; i < ids.size(); i++)
+            names[s].push_back(string(shards[s].species_name(ids[i])));
+    });
+    for (const string & name : merged(names))
+        out << name << endl;
+}
+
+/* each shard is already sorted by species and then id, so their trees are merged with a heap
+ * of the next tree of every shard
+ */
+void ShardedTreeCollection::print(ostream & out ) const {
+    vector<vector<Tree> > trees(SHARDS);
+    pool.run(SHARDS, [&](int s) {
+        shards[s].for_each_tree([&](const Tree & t) {
+            trees[s].push_back(t);
+        });
+    });
+    typedef pair<const Tree *, int> Head;      // next tree of a shard, and the shard
+    auto later = [](const Head & a, const Head & b) { return *b.first < *a.first; };
+    priority_queue<Head, vector<Head>, decltype(later)> heads(later);
+    vector<size_t> position(SHARDS, 0);
+    for (int s = 0; s < SHARDS; s++) {
+        if (!trees[s].empty())
+            heads.push(Head(&trees[s][0], s));
+    }
+    while (!heads.empty()) {
+        Head head = heads.top();
+        heads.pop();
+        out << *head.first << endl;
+        int s = head.second;
+        if (++position[s] < trees[s].size())
+            heads.push(Head(&trees[s][position[s]], s));
+    }
+}
+
+list<string> ShardedTreeCollection::get_matching_species(const string & species_name) const {
+    vector<list<string> > names(SHARDS);
+    pool.run(SHARDS, [&](int s) {
+        vector<int> ids;
+        shards[s].get_matching_species(species_name, ids);
+        for (size_t i = 0; i < ids.size(); i++)
+            names[s].push_back(string(shards[s].species_name(ids[i])));
+    });
+    return merged(names);
+}
+
+list<string> ShardedTreeCollection::get_all_in_zipcode(int zipcode) const {
+    vector<list<string> > names(SHARDS);
+    pool.run(SHARDS, [&](int s) {
+        vector<int> ids;
+        shards[s].get_all_in_zipcode(zipcode, ids);
+        for (size_t i = 0; i < ids.size(); i++)
+            names[s].push_back(string(shards[s].species_name(ids[i])));
+    });
+    return merged(names);
+}
+
+list<string> ShardedTreeCollection::get_all_near(double latitude, double longitude,
+                          double  distance) const {
+    vector<list<string> > names(SHARDS);
+    pool.run(SHARDS, [&](int s) {
+        names[s] = shards[s].get_all_near(latitude, longitude, distance);
+    });
+    return merged(names);
+}
+
+void ShardedTreeCollection::begin_bulk() {
+    for (int s = 0; s < SHARDS; s++)
+        shards[s].begin_bulk();
+}
+
+// each shard merges its staged trees on a thread of its own
+void ShardedTreeCollection::end_bulk() {
+    pool.run(SHARDS, [&](int s) {
+        shards[s].end_bulk();
+    });
+}
+
+TreeCollection & ShardedTreeCollection::shard(Borough b) {
+    return shards[b];
+}
+
+const TreeCollection & ShardedTreeCollection::shard(Borough b) const {
+    return shards[b];
+}
+
+// the number of trees of a species in one shard, from a count-only aggregate
+int ShardedTreeCollection::species_count(int shard, const string & species_name) const {
+    TreeFilter filter;
+    filter.species = species_name;
+    vector<AggregateRow> rows = shards[shard].aggregate(vector<GroupColumn>(), filter, METRIC_COUNT);
+    return rows.empty() ? 0 : rows[0].count;
+}
+
+// joins the shards' names into one sorted list without duplicates
+/* each shard writes a species under the first spelling it saw, which need not be the same in every
+ * shard, so names are joined on their folded form, keeping the spelling that sorts first
+ */
+list<string> ShardedTreeCollection::merged(const vector<list<string> > & lists) const {
+    map<string, string> by_folded;
+    char buf[SpeciesDictionary::MAX_NAME];
+    for (size_t s = 0; s < lists.size(); s++) {
+        for (const string & name : lists[s]) {
+            string_view folded = SpeciesDictionary::fold(name, buf);
+            string key = (folded.data() == nullptr) ? name : string(folded);
+            map<string, string>::iterator it = by_folded.find(key);
+            if (it == by_folded.end())
+                by_folded.insert(make_pair(key, name));
+            else if (name < it->second)
+                it->second = name;
+        }
+    }
+    set<string> names;
+    for (auto & name : by_folded)
+        names.insert(name.second);
+    return list<string>(names.begin(), names.end());
+}
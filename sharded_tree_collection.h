@@ -0,0 +1,129 @@
+/******************************************************************************
+Title : sharded_tree_collection.h
+Author : Yu Tong Chen
+Created on : 05/14/2019
+Description : The interface of ShardedTreeCollection, a derived class of
+              __tree_collection that keeps each borough's trees in a
+              TreeCollection of its own.
+Usage : Use in place of TreeCollection to spread queries over the cores.
+Build with : Makefile (needs -pthread)
+Modifications:
+
+******************************************************************************/
+
+#ifndef SHARDED_TREE_COLLECTION_H
+#define SHARDED_TREE_COLLECTION_H
+#include "tree_collection.h"
+#include "thread_pool.h"
+#include <set>
+
+
+using namespace std;
+
+/** class ShardedTreeCollection
+ *  add_tree routes each tree to the shard of its borough; trees without a
+ *  valid borough go to one more shard of their own. A query about one
+ *  borough asks only that shard. A query about the whole city runs on
+ *  every shard at once on a ThreadPool, and the answers are merged:
+ *  counts are added and name lists are joined without duplicates,
+ *  names that differ only in case or hyphens counting as one.
+ *
+ *  Queries on different shards share nothing, so they are safe to run in
+ *  parallel; a query on the collection as a whole is not safe to run
+ *  alongside add_tree or remove_tree, as with TreeCollection.
+ */
+class ShardedTreeCollection:public __TreeCollection {
+    public:
+        // one shard per borough, and the last for trees without one
+        static const int SHARDS = BOROUGHS + 1;
+
+        /** ShardedTreeCollection(n) fans queries out over n threads, the
+         *                          caller's included; 0 means one per
+         *                          hardware thread
+         */
+        explicit ShardedTreeCollection(int threads = 0);
+        ~ShardedTreeCollection();
+
+        /** total_tree_count() returns total number of trees in data set
+         * @notes
+         *       Trees without a borough are counted, as every query about the
+         *       whole city counts them; only the per-borough queries leave
+         *       them out.
+         *  @return int count of trees in all the shards
+         */
+        int total_tree_count() override;
+
+        /** count_of_tree_species(s) returns number of trees with name s
+         * @param  string species_name [in] species name to search for
+         * @return int the number of trees that have the given species name
+         */
+        int count_of_tree_species ( const string & species_name ) override;
+
+        /** count_of_tree_species_in_boro(s,b) returns number of trees with name s
+         *                                     in boro b, asking only b's shard
+         * @param  string species_name [in] species name to search for
+         * @param  string boro_name [in] species borough to look in
+         * @return int the number of trees in boro that have the given species name
+         */
+        int count_of_tree_species_in_boro ( const string & species_name,
+                                            const string & boro_name ) override;
+
+        /** get_counts_of_trees_by_boro(s,t) puts number of trees matching name s
+         *                                     in all boros into param t
+         * @param  string species_name [in] species name to search for
+         * @param  boro boro_name[5] [in,out] array of boro structures
+         * @return int the total number of trees of given species in all boros
+         */
+        int get_counts_of_trees_by_boro ( const string & species_name,
+                                           boro  tree_count[5] ) override;
+
+        /** count_of_trees_in_boro(b) returns number of trees of all types in boro b
+         * @param  string boro_name [in] species borough to look in
+         * @return int the number of trees in boro boro_name
+         */
+        int count_of_trees_in_boro( const string & boro_name ) override;
+
+        /** add_tree(t) inserts Tree t into the shard of its borough
+         * @note  tree_id is unique across all the shards.
+         * @param Tree new_tree [in] the tree to be inserted
+         * @return int the number of trees inserted: 0 if none, 1 if inserted
+         */
+        int add_tree( Tree & new_tree) override;
+
+        /** remove_tree(t) removes Tree t from the shard that holds it
+         * @param Tree old_tree [in] the tree to be removed
+         * @return int the number of trees removed: 0 if none, 1 if removed
+         */
+        int remove_tree( const Tree & old_tree);
+
+        void print_all_species(ostream & out) const override;
+        void print(ostream & out ) const override;
+        list<string> get_matching_species(
+                               const string & species_name) const override;
+        list<string> get_all_in_zipcode(int zipcode) const override;
+        list<string> get_all_near(double latitude, double longitude,
+                             double  distance) const override;
+
+        /** begin_bulk() and end_bulk() bracket a load on every shard, as
+         *                           TreeCollection::begin_bulk does
+         */
+        void begin_bulk();
+        void end_bulk();
+
+        /** shard(b) returns the collection holding the trees of borough b,
+         *           or those without a borough if b is BOROUGHS
+         */
+        TreeCollection & shard(Borough b);
+        const TreeCollection & shard(Borough b) const;
+
+    private:
+        TreeCollection       shards[SHARDS];
+        TreeIdIndex          shard_of_id;    // tree_id -> shard
+        mutable ThreadPool   pool;
+
+        int species_count(int shard, const string & species_name) const;
+        list<string> merged(const vector<list<string> > & lists) const;
+};
+
+
+#endif //SHARDED_TREE_COLLECTION_H
@@ -0,0 +1,247 @@
+/******************************************************************************
+Title : slot_bitmap.cpp
+Author : Yu Tong Chen
+Created on : 05/01/2019
+Description : The implementation of slot_bitmap.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "slot_bitmap.h"
+#include <algorithm>
+#include <iterator>
+
+// default constructor
+SlotBitmap::SlotBitmap() {
+}
+
+// returns the index of the chunk with key, or -(where it would go) - 1
+int SlotBitmap::find_chunk(uint16_t key) const {
+    int lo = 0, hi = chunks.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (chunks[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < (int)chunks.size() && chunks[lo].key == key)
+        return lo;
+    return -lo - 1;
+}
+
+void SlotBitmap::add(int slot) {
+    uint16_t key = slot >> 16;
+    uint16_t low = slot & 0xFFFF;
+    int c = find_chunk(key);
+    if (c < 0) {
+        c = -c - 1;
+        Chunk chunk;
+        chunk.key = key;
+        chunk.count = 0;
+        chunks.insert(chunks.begin() + c, chunk);
+    }
+    Chunk & chunk = chunks[c];
+    if (!chunk.bits.empty()) {
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(chunk.bits[low >> 6] & mask)) {
+            chunk.bits[low >> 6] |= mask;
+            chunk.count++;
+        }
+        return;
+    }
+    vector<uint16_t>::iterator it = lower_bound(chunk.array.begin(), chunk.array.end(), low);
+    if (it != chunk.array.end() && *it == low)
+        return;
+    chunk.array.insert(it, low);
+    chunk.count++;
+    fit(chunk);
+}
+
+void SlotBitmap::remove(int slot) {
+    uint16_t key = slot >> 16;
+    uint16_t low = slot & 0xFFFF;
+    int c = find_chunk(key);
+    if (c < 0)
+        return;
+    Chunk & chunk = chunks[c];
+    if (!chunk.bits.empty()) {
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(chunk.bits[low >> 6] & mask))
+            return;
+        chunk.bits[low >> 6] &= ~mask;
+        chunk.count--;
+    }
+    else {
+        vector<uint16_t>::iterator it = lower_bound(chunk.array.begin(), chunk.array.end(), low);
+        if (it == chunk.array.end() || *it != low)
+            return;
+        chunk.array.erase(it);
+        chunk.count--;
+    }
+    if (chunk.count == 0)
+        chunks.erase(chunks.begin() + c);
+    else
+        fit(chunk);
+}
+
+bool SlotBitmap::contains(int slot) const {
+    uint16_t low = slot & 0xFFFF;
+    int c = find_chunk(slot >> 16);
+    if (c < 0)
+        return false;
+    const Chunk & chunk = chunks[c];
+    if (!chunk.bits.empty())
+        return (chunk.bits[low >> 6] >> (low & 63)) & 1;
+    return binary_search(chunk.array.begin(), chunk.array.end(), low);
+}
+
+void SlotBitmap::clear() {
+    chunks.clear();
+}
+
+int SlotBitmap::cardinality() const {
+    int count = 0;
+    for (size_t c = 0; c < chunks.size(); c++)
+        count += chunks[c].count;
+    return count;
+}
+
+bool SlotBitmap::isEmpty() const {
+    return chunks.empty();
+}
+
+SlotBitmap SlotBitmap::operator&(const SlotBitmap & rhs) const {
+    return combine(rhs, AND);
+}
+
+SlotBitmap SlotBitmap::operator|(const SlotBitmap & rhs) const {
+    return combine(rhs, OR);
+}
+
+SlotBitmap SlotBitmap::and_not(const SlotBitmap & rhs) const {
+    return combine(rhs, AND_NOT);
+}
+
+// turns an array chunk into a bitmap chunk
+void SlotBitmap::to_bitmap(Chunk & c) {
+    c.bits.assign(WORDS, 0);
+    for (size_t i = 0; i < c.array.size(); i++)
+        c.bits[c.array[i] >> 6] |= 1ULL << (c.array[i] & 63);
+    vector<uint16_t>().swap(c.array);
+}
+
+// picks the smaller layout for the chunk's count
+void SlotBitmap::fit(Chunk & c) {
+    if (c.bits.empty() && c.count > ARRAY_MAX) {
+        to_bitmap(c);
+    }
+    else if (!c.bits.empty() && c.count <= ARRAY_MAX) {
+        c.array.clear();
+        c.array.reserve(c.count);
+        for (int w = 0; w < WORDS; w++) {
+            for (uint64_t word = c.bits[w]; word != 0; word &= word - 1)
+                c.array.push_back((w << 6) | __builtin_ctzll(word));
+        }
+        vector<uint64_t>().swap(c.bits);
+    }
+}
+
+/* combines two chunks with the same key
+ * two arrays merge; a bitmap with an array tests or flips one bit per array entry; two bitmaps go a word at a time
+ */
+SlotBitmap::Chunk SlotBitmap::combine(const Chunk & a, const Chunk & b, Operation op) {
+    Chunk r;
+    r.key = a.key;
+    r.count = 0;
+    bool a_bits = !a.bits.empty(), b_bits = !b.bits.empty();
+
+    if (!a_bits && !b_bits) {
+        back_insert_iterator<vector<uint16_t> > out(r.array);
+        if (op == AND)
+            set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), out);
+        else if (op == OR)
+            set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), out);
+        else
+            set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), out);
+        r.count = r.array.size();
+    }
+    else if (a_bits && b_bits) {
+        r.bits.resize(WORDS);
+        for (int w = 0; w < WORDS; w++) {
+            uint64_t x = a.bits[w], y = b.bits[w];
+            r.bits[w] = (op == AND) ? (x & y) : (op == OR) ? (x | y) : (x & ~y);
+            r.count += __builtin_popcountll(r.bits[w]);
+        }
+    }
+    else if (op == OR) {
+        const Chunk & bitmap = a_bits ? a : b;
+        const Chunk & array = a_bits ? b : a;
+        r.bits = bitmap.bits;
+        r.count = bitmap.count;
+        for (size_t i = 0; i < array.array.size(); i++) {
+            uint16_t v = array.array[i];
+            uint64_t mask = 1ULL << (v & 63);
+            r.count += !(r.bits[v >> 6] & mask);
+            r.bits[v >> 6] |= mask;
+        }
+    }
+    else if (!a_bits) {             // AND or AND_NOT of an array with a bitmap: filter the array
+        bool keep_if_set = (op == AND);
+        for (size_t i = 0; i < a.array.size(); i++) {
+            uint16_t v = a.array[i];
+            if (((b.bits[v >> 6] >> (v & 63)) & 1) == keep_if_set)
+                r.array.push_back(v);
+        }
+        r.count = r.array.size();
+    }
+    else if (op == AND) {           // bitmap AND array: the array entries that are set
+        for (size_t i = 0; i < b.array.size(); i++) {
+            uint16_t v = b.array[i];
+            if ((a.bits[v >> 6] >> (v & 63)) & 1)
+                r.array.push_back(v);
+        }
+        r.count = r.array.size();
+    }
+    else {                          // bitmap AND_NOT array: clear the array entries
+        r.bits = a.bits;
+        r.count = a.count;
+        for (size_t i = 0; i < b.array.size(); i++) {
+            uint16_t v = b.array[i];
+            uint64_t mask = 1ULL << (v & 63);
+            r.count -= (r.bits[v >> 6] & mask) != 0;
+            r.bits[v >> 6] &= ~mask;
+        }
+    }
+    if (r.count > 0)
+        fit(r);
+    return r;
+}
+
+// walks both chunk lists in key order; a chunk with no partner is kept or dropped as op says
+SlotBitmap SlotBitmap::combine(const SlotBitmap & rhs, Operation op) const {
+    SlotBitmap result;
+    size_t i = 0, j = 0;
+    while (i < chunks.size() || j < rhs.chunks.size()) {
+        if (j == rhs.chunks.size() || (i < chunks.size() && chunks[i].key < rhs.chunks[j].key)) {
+            if (op != AND)
+                result.chunks.push_back(chunks[i]);
+            i++;
+        }
+        else if (i == chunks.size() || rhs.chunks[j].key < chunks[i].key) {
+            if (op == OR)
+                result.chunks.push_back(rhs.chunks[j]);
+            j++;
+        }
+        else {
+            Chunk c = combine(chunks[i], rhs.chunks[j], op);
+            if (c.count > 0)
+                result.chunks.push_back(c);
+            i++;
+            j++;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+Title : slot_bitmap.h
+Author : Yu Tong Chen
+Created on : 05/01/2019
+Description : The interface of SlotBitmap, a compressed set of tree slots
+              used as a bitmap index.
+Usage : TreeCollection keeps one per value of status, health and borough;
+        combine them with &, | and and_not, then count or list the result.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef SLOT_BITMAP_H
+#define SLOT_BITMAP_H
+#include <cstdint>
+#include <vector>
+
+
+using namespace std;
+
+/** class SlotBitmap
+ *  Slots are split into chunks of 65536 by their high 16 bits, as Roaring
+ *  bitmaps do. A chunk holding at most 4096 slots is a sorted array of
+ *  their low 16 bits; a fuller chunk is a plain 8 KB bitmap. Either way a
+ *  chunk never takes more than 8 KB, and two bitmap chunks combine one
+ *  64-bit word at a time.
+ */
+class SlotBitmap {
+    public:
+        SlotBitmap();
+
+        void add(int slot);
+        void remove(int slot);
+        bool contains(int slot) const;
+        void clear();
+
+        /** cardinality() returns the number of slots in the set */
+        int  cardinality() const;
+        bool isEmpty() const;
+
+        /** operator&(a,b), operator|(a,b) and a.and_not(b) return the slots
+         *  in both, in either, and in a but not in b
+         */
+        SlotBitmap operator&(const SlotBitmap & rhs) const;
+        SlotBitmap operator|(const SlotBitmap & rhs) const;
+        SlotBitmap and_not(const SlotBitmap & rhs) const;
+
+        /** for_each(visit) calls visit(slot) for every slot, in increasing order */
+        template <class Visit>
+        void for_each(Visit visit) const {
+            for (size_t c = 0; c < chunks.size(); c++) {
+                int high = chunks[c].key << 16;
+                if (chunks[c].bits.empty()) {
+                    for (size_t i = 0; i < chunks[c].array.size(); i++)
+                        visit(high | chunks[c].array[i]);
+                }
+                else {
+                    for (int w = 0; w < WORDS; w++) {
+                        for (uint64_t word = chunks[c].bits[w]; word != 0; word &= word - 1)
+                            visit(high | (w << 6) | __builtin_ctzll(word));
+                    }
+                }
+            }
+        }
+
+    private:
+        static const int ARRAY_MAX = 4096;    // larger chunks are bitmaps
+        static const int WORDS = 1024;        // 64-bit words in a bitmap chunk
+
+        struct Chunk {
+            uint16_t         key;      // the high 16 bits of its slots
+            int              count;
+            vector<uint16_t> array;    // sorted low bits, when bits is empty
+            vector<uint64_t> bits;     // WORDS words, or empty
+        };
+        vector<Chunk> chunks;          // sorted by key, none empty
+
+        enum Operation { AND, OR, AND_NOT };
+
+        int  find_chunk(uint16_t key) const;
+        static void to_bitmap(Chunk & c);
+        static void fit(Chunk & c);
+        static Chunk combine(const Chunk & a, const Chunk & b, Operation op);
+        SlotBitmap combine(const SlotBitmap & rhs, Operation op) const;
+};
+
+
+#endif //SLOT_BITMAP_H
@@ -0,0 +1,165 @@
+/******************************************************************************
+Title : species_bk_tree.cpp
+Author : Yu Tong Chen
+Created on : 05/12/2019
+Description : The implementation of species_bk_tree.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "species_bk_tree.h"
+#include "species_dictionary.h"
+#include <algorithm>
+#include <cstring>
+
+// default constructor
+SpeciesBkTree::SpeciesBkTree():names(0) {
+}
+
+// walks down the children at the new key's distance until there is none, and hangs the key there
+void SpeciesBkTree::insert(const string & name) {
+    string key = SpeciesDictionary::fold(name);
+    if (nodes.empty()) {
+        nodes.push_back(Node());
+        nodes[0].key = key;
+        nodes[0].names.push_back(name);
+        names++;
+        return;
+    }
+    Pattern p;
+    bool short_key = key.size() <= 64;
+    if (short_key)
+        make_pattern(key, p);
+    int n = 0;
+    while (true) {
+        int d = short_key ? distance(p, nodes[n].key) : edit_distance(key, nodes[n].key);
+        if (d == 0) {
+            if (std::find(nodes[n].names.begin(), nodes[n].names.end(), name) == nodes[n].names.end()) {
+                nodes[n].names.push_back(name);
+                names++;
+            }
+            return;
+        }
+        int next = -1;
+        for (size_t c = 0; c < nodes[n].children.size(); c++) {
+            if (nodes[n].children[c].first == d) {
+                next = nodes[n].children[c].second;
+                break;
+            }
+        }
+        if (next < 0) {
+            nodes[n].children.push_back(make_pair(d, (int)nodes.size()));
+            nodes.push_back(Node());
+            nodes.back().key = key;
+            nodes.back().names.push_back(name);
+            names++;
+            return;
+        }
+        n = next;
+    }
+}
+
+void SpeciesBkTree::find(const string & name, int max_distance, vector<Match> & out) const {
+    out.clear();
+    if (nodes.empty() || max_distance < 0)
+        return;
+    string key = SpeciesDictionary::fold(name);
+    Pattern p;
+    bool short_key = key.size() <= 64;
+    if (short_key)
+        make_pattern(key, p);
+
+    vector<int> pending(1, 0);
+    while (!pending.empty()) {
+        const Node & node = nodes[pending.back()];
+        pending.pop_back();
+        int d = short_key ? distance(p, node.key) : edit_distance(key, node.key);
+        if (d <= max_distance) {
+            for (size_t i = 0; i < node.names.size(); i++) {
+                Match m = { d, node.names[i] };
+                out.push_back(m);
+            }
+        }
+        for (size_t c = 0; c < node.children.size(); c++) {
+            if (node.children[c].first >= d - max_distance && node.children[c].first <= d + max_distance)
+                pending.push_back(node.children[c].second);
+        }
+    }
+    sort(out.begin(), out.end(), [](const Match & a, const Match & b) {
+        return a.distance != b.distance ? a.distance < b.distance : a.name < b.name;
+    });
+}
+
+int SpeciesBkTree::edit_distance(string_view a, string_view b) {
+    if (a.size() > b.size())
+        swap(a, b);
+    if (a.size() > 64)
+        return dynamic_distance(a, b);
+    Pattern p;
+    make_pattern(a, p);
+    return distance(p, b);
+}
+
+void SpeciesBkTree::make_pattern(string_view text, Pattern & p) {
+    memset(p.peq, 0, sizeof(p.peq));
+    for (size_t i = 0; i < text.size(); i++)
+        p.peq[(unsigned char)text[i]] |= 1ULL << i;
+    p.length = text.size();
+}
+
+/* Myers' algorithm, as Hyyro states it for edit distance
+ * bit i of Pv and Mv says whether the cell of pattern row i went up or down by one from the row above,
+ * within the current column of text; one column costs a few word operations. Row 0 grows by one every
+ * column, which is the 1 shifted into Ph
+ */
+int SpeciesBkTree::distance(const Pattern & p, string_view text) {
+    if (p.length == 0)
+        return text.size();
+    uint64_t high = 1ULL << (p.length - 1);
+    uint64_t pv = ~0ULL, mv = 0;
+    int score = p.length;
+    for (size_t j = 0; j < text.size(); j++) {
+        uint64_t eq = p.peq[(unsigned char)text[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & high)
+            score++;
+        else if (mh & high)
+            score--;
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+// the usual row by row dynamic program, for names too long for one word
+int SpeciesBkTree::dynamic_distance(string_view a, string_view b) {
+    vector<int> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++)
+        row[j] = j;
+    for (size_t i = 1; i <= a.size(); i++) {
+        int diagonal = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= b.size(); j++) {
+            int above = row[j];
+            row[j] = min(min(row[j] + 1, row[j - 1] + 1), diagonal + (a[i - 1] != b[j - 1]));
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+int SpeciesBkTree::size() const {
+    return names;
+}
+
+void SpeciesBkTree::clear() {
+    nodes.clear();
+    names = 0;
+}
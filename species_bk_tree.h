@@ -0,0 +1,83 @@
+/******************************************************************************
+Title : species_bk_tree.h
+Author : Yu Tong Chen
+Created on : 05/12/2019
+Description : The interface of SpeciesBkTree, a BK-tree of species common
+              names for finding the names closest to a misspelled one.
+Usage : Kept by TreeSpecies::add_species; queried through
+        TreeSpecies::get_similar_species and lookup_species.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef SPECIES_BK_TREE_H
+#define SPECIES_BK_TREE_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+using namespace std;
+
+/** class SpeciesBkTree
+ *  Names are compared folded (lower case, '-' read as ' ') by Levenshtein
+ *  distance. Every child of a node sits at a known distance from it, so by
+ *  the triangle inequality a search within k of a query only descends into
+ *  the children whose distance is within k of the query's distance to the
+ *  node, and most of the tree is never compared.
+ *
+ *  Distances are computed with Myers' bit-parallel algorithm, which handles
+ *  64 pattern characters per machine word; a pair of names both longer than
+ *  that falls back to the usual dynamic program.
+ */
+class SpeciesBkTree {
+    public:
+        // a name found by find, and its distance from the query
+        struct Match {
+            int    distance;
+            string name;
+        };
+
+        SpeciesBkTree();
+
+        /** insert(s) adds the species name s */
+        void insert(const string & name);
+
+        /** find(s,k,out) puts every name within edit distance k of s into
+         *               out, closest first and then in name order, after
+         *               clearing it
+         */
+        void find(const string & name, int max_distance, vector<Match> & out) const;
+
+        /** edit_distance(a,b) returns the Levenshtein distance between a and b */
+        static int edit_distance(string_view a, string_view b);
+
+        int  size() const;
+        void clear();
+
+    private:
+        struct Node {
+            string               key;        // folded name
+            vector<string>       names;      // the names that fold to key
+            vector<pair<int, int> > children;   // (distance from key, node index)
+        };
+
+        // the bit mask of each character's positions in a pattern of up to 64 characters
+        struct Pattern {
+            uint64_t peq[256];
+            int      length;
+        };
+
+        vector<Node> nodes;     // nodes[0] is the root
+        int          names;     // names inserted, counting each once
+
+        static void make_pattern(string_view text, Pattern & p);
+        static int  distance(const Pattern & p, string_view text);
+        static int  dynamic_distance(string_view a, string_view b);
+};
+
+
+#endif //SPECIES_BK_TREE_H
@@ -0,0 +1,88 @@
+/******************************************************************************
+Title : species_dictionary.cpp
+Author : Yu Tong Chen
+Created on : 05/03/2019
+Description : The implementation of species_dictionary.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "species_dictionary.h"
+
+// default constructor
+SpeciesDictionary::SpeciesDictionary() {
+}
+
+int SpeciesDictionary::intern(string_view name) {
+    unordered_map<string_view, int>::const_iterator it = by_name.find(name);
+    if (it != by_name.end())
+        return it->second;
+
+    int id = names.size();
+    names.push_back(string(name));
+    folded_names.push_back(fold(name));
+    by_name.insert(make_pair(string_view(names.back()), id));
+    // keeps the first id
+    folded_ids.push_back(by_folded.insert(make_pair(string_view(folded_names.back()), id)).first->second);
+    return id;
+}
+
+int SpeciesDictionary::lookup(string_view name) const {
+    char buf[MAX_NAME];
+    string_view key = fold(name, buf);
+    if (key.data() == nullptr)
+        return -1;
+    unordered_map<string_view, int>::const_iterator it = by_folded.find(key);
+    return it == by_folded.end() ? -1 : it->second;
+}
+
+string_view SpeciesDictionary::fold(string_view name, char *buf) {
+    if (name.size() > (size_t)MAX_NAME)
+        return string_view();
+    for (size_t i = 0; i < name.size(); i++)
+        buf[i] = fold(name[i]);
+    return string_view(buf, name.size());
+}
+
+string SpeciesDictionary::fold(string_view name) {
+    string folded(name);
+    for (size_t i = 0; i < folded.size(); i++)
+        folded[i] = fold(folded[i]);
+    return folded;
+}
+
+bool SpeciesDictionary::folds_to(string_view name, string_view folded) {
+    if (name.size() != folded.size())
+        return false;
+    for (size_t i = 0; i < name.size(); i++) {
+        if (fold(name[i]) != folded[i])
+            return false;
+    }
+    return true;
+}
+
+int SpeciesDictionary::folded_id(int id) const {
+    return folded_ids[id];
+}
+
+string_view SpeciesDictionary::name(int id) const {
+    return names[id];
+}
+
+string_view SpeciesDictionary::folded(int id) const {
+    return folded_names[id];
+}
+
+int SpeciesDictionary::size() const {
+    return names.size();
+}
+
+void SpeciesDictionary::clear() {
+    by_name.clear();
+    by_folded.clear();
+    names.clear();
+    folded_names.clear();
+    folded_ids.clear();
+}
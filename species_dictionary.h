@@ -0,0 +1,90 @@
+/******************************************************************************
+Title : species_dictionary.h
+Author : Yu Tong Chen
+Created on : 05/03/2019
+Description : The interface of SpeciesDictionary, which gives every species
+              common name a small integer id.
+Usage : Used by TreeColumns; the ids are what the allocation-free queries
+        of TreeCollection return.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef SPECIES_DICTIONARY_H
+#define SPECIES_DICTIONARY_H
+#include <cctype>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+using namespace std;
+
+/** class SpeciesDictionary
+ *  Ids are handed out in order 0, 1, 2, ... and never change. Names are
+ *  kept in a deque, which never moves them, so the string_views returned
+ *  by name() stay valid until clear(). Each name is also kept folded
+ *  (lower case, '-' read as ' '), which is how the queries compare names.
+ */
+class SpeciesDictionary {
+    public:
+        // the longest name lookup() and matching() will fold
+        static const int MAX_NAME = 127;
+
+        SpeciesDictionary();
+
+        /** intern(s) returns the id of s, giving it the next id if it is new */
+        int intern(string_view name);
+
+        /** lookup(s) returns the id of the first name that folds to the same
+         *  string as s, or -1 if there is none; it does not allocate
+         */
+        int lookup(string_view name) const;
+
+        /** fold(s,buf) writes s folded into buf, which holds MAX_NAME chars
+         *  @return string_view the folded name in buf, or an empty view with
+         *          a null data() if s is longer than MAX_NAME
+         */
+        static string_view fold(string_view name, char *buf);
+
+        /** fold(s) returns s folded, whatever its length; every module that
+         *  compares species names folds them with this or the above
+         */
+        static string fold(string_view name);
+
+        /** fold(c) returns c folded; the char is read as unsigned, as
+         *  tolower requires
+         */
+        static char fold(char c) {
+            return (c == '-') ? ' ' : (char)tolower((unsigned char)c);
+        }
+
+        /** folds_to(s,f) returns true if s folds to f, comparing a char at a
+         *  time so that nothing is allocated
+         */
+        static bool folds_to(string_view name, string_view folded);
+
+        /** folded_id(id) returns the id lookup() gives for the name of id,
+         *  the first id whose name folds the same; queries that treat
+         *  spellings alike count and report species by it
+         */
+        int folded_id(int id) const;
+
+        string_view name(int id) const;
+        string_view folded(int id) const;
+        int  size() const;
+        void clear();
+
+    private:
+        deque<string>                    names;
+        deque<string>                    folded_names;
+        vector<int>                      folded_ids;    // folded_id() of each id
+        unordered_map<string_view, int>  by_name;       // views into names
+        unordered_map<string_view, int>  by_folded;     // views into folded_names
+};
+
+
+#endif //SPECIES_DICTIONARY_H
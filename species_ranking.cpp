@@ -0,0 +1,100 @@
+/******************************************************************************
+Title : species_ranking.cpp
+Author : Yu Tong Chen
+Created on : 05/10/2019
+Description : The implementation of species_ranking.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "species_ranking.h"
+
+// default constructor
+SpeciesRanking::SpeciesRanking():live(0) {
+}
+
+void SpeciesRanking::swap_places(int i, int j) {
+    int a = order[i], b = order[j];
+    order[i] = b;
+    order[j] = a;
+    position[a] = j;
+    position[b] = i;
+}
+
+/* the id swaps with the first id of its block, which then starts one later,
+ * and its old place becomes the last of the block one count up
+ * a new id joins the block of count 0 at the end first
+ */
+void SpeciesRanking::add(int id) {
+    if (id >= (int)position.size()) {
+        position.resize(id + 1, -1);
+        counts.resize(id + 1, 0);
+    }
+    if (position[id] < 0) {
+        int p = order.size();
+        order.push_back(id);
+        position[id] = p;
+        if (first.empty()) {
+            first.push_back(p);
+            last.push_back(p);
+        }
+        if (p == 0 || counts[order[p - 1]] != 0)     // the block of count 0 was empty
+            first[0] = p;
+        last[0] = p;
+    }
+    int c = counts[id];
+    int q = first[c];
+    swap_places(position[id], q);
+    first[c] = q + 1;
+    if ((int)first.size() <= c + 1) {
+        first.push_back(q);
+        last.push_back(q);
+    }
+    if (q == 0 || counts[order[q - 1]] != c + 1)     // the block one count up was empty
+        first[c + 1] = q;
+    last[c + 1] = q;
+    counts[id] = c + 1;
+    if (c == 0)
+        live++;
+}
+
+// the reverse of add: the id swaps with the last id of its block and becomes the first of the block below
+void SpeciesRanking::remove(int id) {
+    if (id >= (int)position.size() || counts[id] == 0)
+        return;
+    int c = counts[id];
+    int q = last[c];
+    swap_places(position[id], q);
+    last[c] = q - 1;
+    if (q + 1 == (int)order.size() || counts[order[q + 1]] != c - 1)   // the block below was empty
+        last[c - 1] = q;
+    first[c - 1] = q;
+    counts[id] = c - 1;
+    if (c == 1)
+        live--;
+}
+
+int SpeciesRanking::count(int id) const {
+    return id < (int)counts.size() ? counts[id] : 0;
+}
+
+int SpeciesRanking::size() const {
+    return live;
+}
+
+void SpeciesRanking::top(int n, vector<pair<int, int> > & out) const {
+    out.clear();
+    for (int i = 0; i < n && i < live; i++)
+        out.push_back(make_pair(order[i], counts[order[i]]));
+}
+
+void SpeciesRanking::clear() {
+    order.clear();
+    position.clear();
+    counts.clear();
+    first.clear();
+    last.clear();
+    live = 0;
+}
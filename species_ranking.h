@@ -0,0 +1,64 @@
+/******************************************************************************
+Title : species_ranking.h
+Author : Yu Tong Chen
+Created on : 05/10/2019
+Description : The interface of SpeciesRanking, the species ids of a group of
+              trees kept in order of how many trees each has.
+Usage : TreeCollection keeps one for the city, one per borough and one per
+        zipcode, and answers top_species from them.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef SPECIES_RANKING_H
+#define SPECIES_RANKING_H
+#include <utility>
+#include <vector>
+
+
+using namespace std;
+
+/** class SpeciesRanking
+ *  The ids are kept in one array, most trees first, so the ids with the
+ *  same count form a block. A tree added moves its species from the front
+ *  of its block to the end of the block above by one swap, and a tree
+ *  removed does the reverse, so both are O(1). The top n are the first n
+ *  entries of the array. Species with equal counts come in no set order.
+ */
+class SpeciesRanking {
+    public:
+        SpeciesRanking();
+
+        /** add(id) counts one more tree of species id */
+        void add(int id);
+
+        /** remove(id) counts one fewer tree of species id, if it has any */
+        void remove(int id);
+
+        /** count(id) returns the number of trees of species id */
+        int count(int id) const;
+
+        /** size() returns the number of species with at least one tree */
+        int size() const;
+
+        /** top(n,out) puts the (id, count) of the n species with the most
+         *             trees into out, most first, after clearing it
+         */
+        void top(int n, vector<pair<int, int> > & out) const;
+
+        void clear();
+
+    private:
+        vector<int> order;      // ids by count, most first; ids down to 0 trees stay at the end
+        vector<int> position;   // id -> index in order, or -1
+        vector<int> counts;     // id -> trees
+        vector<int> first;      // count -> index in order where its block starts
+        vector<int> last;       // count -> index in order where its block ends
+        int         live;       // ids in order with a count above 0
+
+        void swap_places(int i, int j);
+};
+
+
+#endif //SPECIES_RANKING_H
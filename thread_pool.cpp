@@ -0,0 +1,93 @@
+/******************************************************************************
+Title : thread_pool.cpp
+Author : Yu Tong Chen
+Created on : 05/14/2019
+Description : The implementation of thread_pool.
+Usage :
+Build with : Makefile (needs -pthread)
+Modifications:
+
+******************************************************************************/
+
+#include "thread_pool.h"
+
+// the pool whose task the current thread is running, if any
+static thread_local const ThreadPool *running_in = nullptr;
+
+// constructor
+ThreadPool::ThreadPool(int threads)
+    :task(nullptr), next(0), count(0), unfinished(0), stopping(false) {
+    if (threads <= 0)
+        threads = thread::hardware_concurrency();
+    for (int i = 1; i < threads; i++)
+        workers.push_back(thread(&ThreadPool::work, this));
+}
+
+// destructor
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+// the caller takes task numbers like any worker, then waits for the ones still running elsewhere
+void ThreadPool::run(int n, const function<void(int)> & t) {
+    if (n <= 0)
+        return;
+    if (running_in == this || workers.empty()) {    // nested, or nothing to share with
+        for (int i = 0; i < n; i++)
+            t(i);
+        return;
+    }
+    lock_guard<mutex> one_at_a_time(run_lock);
+    const ThreadPool *outer = running_in;
+    running_in = this;
+    unique_lock<mutex> guard(lock);
+    task = &t;
+    next = 0;
+    count = n;
+    unfinished = n;
+    work_ready.notify_all();
+    while (next < count) {
+        int i = next++;
+        guard.unlock();
+        t(i);
+        guard.lock();
+        if (--unfinished == 0)
+            work_done.notify_all();
+    }
+    work_done.wait(guard, [this] { return unfinished == 0; });
+    task = nullptr;
+    count = 0;
+    running_in = outer;
+}
+
+int ThreadPool::size() const {
+    return workers.size() + 1;
+}
+
+ThreadPool & ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::work() {
+    running_in = this;
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        work_ready.wait(guard, [this] { return stopping || next < count; });
+        if (stopping)
+            return;
+        int i = next++;
+        const function<void(int)> *t = task;
+        guard.unlock();
+        (*t)(i);
+        guard.lock();
+        if (--unfinished == 0)
+            work_done.notify_all();
+    }
+}
@@ -0,0 +1,68 @@
+/******************************************************************************
+Title : thread_pool.h
+Author : Yu Tong Chen
+Created on : 05/14/2019
+Description : The interface of ThreadPool, a fixed set of threads that run
+              the numbered tasks of one fan-out at a time.
+Usage : pool.run(n, [&](int i) { ... });   // returns when all n are done
+Build with : Makefile (needs -pthread)
+Modifications:
+
+******************************************************************************/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+/** class ThreadPool
+ *  The threads are started once and sleep between fan-outs. run hands out
+ *  task numbers one at a time to whichever thread is free, the calling
+ *  thread included, so a slow task does not hold up the others. Calls to
+ *  run from different threads take turns, and a call made from inside a
+ *  task of the same pool runs its tasks in the calling thread.
+ */
+class ThreadPool {
+    public:
+        /** ThreadPool(n) starts n - 1 threads, the caller of run being the
+         *               n-th; 0 means one per hardware thread
+         */
+        explicit ThreadPool(int threads = 0);
+        ~ThreadPool();
+
+        /** run(n,task) calls task(0), ..., task(n-1), spread over the threads
+         *             of the pool, and returns when every call has returned
+         */
+        void run(int n, const function<void(int)> & task);
+
+        /** size() returns the number of threads run uses, the caller's included */
+        int size() const;
+
+        /** shared() returns a pool with one thread per hardware thread, started
+         *          on first use, for callers that do not keep their own
+         */
+        static ThreadPool & shared();
+
+    private:
+        vector<thread>            workers;
+        mutex                     lock;
+        mutex                     run_lock;      // one fan-out at a time
+        condition_variable        work_ready;
+        condition_variable        work_done;
+        const function<void(int)> *task;         // the fan-out being run
+        int                       next;          // next task number to hand out
+        int                       count;         // task numbers in this fan-out
+        int                       unfinished;    // handed out or not, but not yet returned
+        bool                      stopping;
+
+        void work();                             // worker thread body
+};
+
+
+#endif //THREAD_POOL_H
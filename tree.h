@@ -41,7 +41,7 @@ Data Dictionary for Input File:
 
 #include <string>
 #include <iostream>
-#include "tree_collection.h"
+#include "tree_schema.h"
 #include <sstream>
 #include <fstream>
 #include <vector>
@@ -74,6 +74,20 @@ public:
      */
     Tree(const string & str) ;
 
+    /** from_csv<Schema>(str) parses a csv string laid out as Schema says
+     *  Works like Tree(str), which is from_csv<Census2015>, for census files
+     *  whose columns are in other positions. See tree_schema.h.
+     *  @param string str [in] one row of the census file
+     *  @return Tree  the parsed tree, or an empty tree if any field is invalid
+     */
+    template <class Schema>
+    static Tree from_csv(const string & str) {
+        TreeRow row;
+        if (!parse_tree_row<Schema>(str, row))
+            return Tree();
+        return Tree(row);
+    }
+
     /** A constructor that expects ten values exactly as specified in the.
      *  data dictionary above. 
      *  This constructor does not validate the values - it assumes they have
@@ -137,8 +151,9 @@ public:
      *  clear, possibly except for life_status(), which returns the tree's status
      *  member, and the tree_health() which returns its health member.
      */
-    string common_name() const;
+    const string & common_name() const;   // a reference, so per-tree queries need not copy it
     string borough_name() const;
+    Borough borough() const;       // borough_name() as a Borough, classified once
     string nearest_address() const;
     string life_status() const;
     string tree_health() const;
@@ -149,6 +164,8 @@ public:
 
 
 private:
+    explicit Tree(const TreeRow & row);  // copies the fields of a parsed row
+
     int    tree_id;    // unique id that  identifies the tree
     int    tree_dbh;   // specifies tree diameter
     string status;     // valid values: ”Alive”, ”Dead”, ”Stump”, or the 
@@ -165,6 +182,7 @@ private:
 
     string boroname;   // valid values: ”Manhattan”, ”Bronx”, ”Brooklyn”, 
                        //        ”Queens”, ”Staten Island”
+    Borough boro_code; // boroname as a Borough, or BOROUGHS if it is not valid
     double latitude;   // x spatial coordinate specifying position in 
                        // New York State state plane coordinates
     double longitude;  // y spatial coordinate specifying position in 
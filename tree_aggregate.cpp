@@ -0,0 +1,389 @@
+/******************************************************************************
+Title : tree_aggregate.cpp
+Author : Yu Tong Chen
+Created on : 04/27/2019
+Description : The implementation of tree_aggregate.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "tree_collection.h"
+#include "tree_aggregate.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+// slots handled per pass of the two inner loops of aggregate
+static const int BLOCK = 256;
+
+// the largest number of groups that aggregate keeps in a dense array
+static const long long DENSE_GROUPS = 1 << 18;
+
+static const int    ZIPCODES = 100000;
+static const string COLUMN_NAMES[] = {"species", "borough", "zipcode", "health", "status"};
+
+/* scratch of the species queries; each thread has its own, shared by every TreeColumns, so const
+ * queries can run at once and still not allocate once it has grown
+ */
+struct SpeciesScratch {
+    vector<unsigned> mark;      // mark[id] == epoch once id is found by the current query
+    unsigned         epoch = 0;
+    vector<uint64_t> bits;      // for count_species_of
+    HyperLogLog      sketch;
+};
+static thread_local SpeciesScratch scratch;
+
+// default constructor
+TreeColumns::TreeColumns() {
+}
+
+void TreeColumns::set(int slot, const Tree & t) {
+    clear(slot);
+    if (slot >= (int)live.size()) {
+        live.resize(slot + 1, 0);
+        dbh.resize(slot + 1, 0);
+        zipcode.resize(slot + 1, 0);
+        latitude.resize(slot + 1, 0);
+        longitude.resize(slot + 1, 0);
+        species.resize(slot + 1, 0);
+        borough.resize(slot + 1, BOROUGHS);
+        health.resize(slot + 1, 0);
+        status.resize(slot + 1, 0);
+    }
+    live[slot] = 1;
+    dbh[slot] = t.diameter();
+    t.get_position(latitude[slot], longitude[slot]);
+    zipcode[slot] = (t.zip_code() >= 0 && t.zip_code() < ZIPCODES) ? t.zip_code() : 0;
+    species[slot] = dictionary.intern(t.common_name());
+    if ((int)species_trees.size() < dictionary.size())
+        species_trees.resize(dictionary.size(), 0);
+    species_trees[dictionary.folded_id(species[slot])]++;
+    borough[slot] = t.borough();
+    int h = health_of(t.tree_health());
+    int st = status_of(t.life_status());
+    health[slot] = (h < HEALTHS) ? h : 0;      // a value that is not valid groups with the empty one
+    status[slot] = (st < STATUSES) ? st : 0;
+}
+
+void TreeColumns::clear(int slot) {
+    if (slot < (int)live.size() && live[slot]) {
+        live[slot] = 0;
+        species_trees[dictionary.folded_id(species[slot])]--;
+    }
+}
+
+void TreeColumns::clear_all() {
+    live.clear();
+    dbh.clear();
+    zipcode.clear();
+    species.clear();
+    borough.clear();
+    health.clear();
+    status.clear();
+    latitude.clear();
+    longitude.clear();
+    dictionary.clear();
+    species_trees.clear();
+}
+
+/* groups are numbered in mixed radix: the code of the first group-by column is the most significant digit
+ * the inner loops have no branches that depend on the data, so the compiler is free to vectorize them
+ */
+vector<AggregateRow> TreeColumns::aggregate(const vector<GroupColumn> & group_by,
+                                            const TreeFilter & filter,
+                                            int metrics) const {
+    vector<AggregateRow> rows;
+    if (dictionary.size() == 0)
+        return rows;
+
+    long long groups = 1;
+    for (size_t c = 0; c < group_by.size(); c++)
+        groups *= cardinality(group_by[c]);
+
+    // the filter, turned into codes once
+    vector<unsigned char> species_ok(dictionary.size(), filter.species.empty());
+    if (!filter.species.empty()) {
+        string name = SpeciesDictionary::fold(filter.species);
+        for (int i = 0; i < dictionary.size(); i++)
+            species_ok[i] = (dictionary.folded(i) == name);
+    }
+    int any_borough = (filter.borough == BOROUGHS);
+    int want_borough = filter.borough;
+    int any_health = filter.health.empty();
+    int want_health = health_of(filter.health);
+    int any_status = filter.status.empty();
+    int want_status = status_of(filter.status);
+    int any_zipcode = (filter.zipcode < 0);
+    int min_dbh = filter.min_dbh;
+    int max_dbh = filter.max_dbh;
+    bool track_range = (metrics & (METRIC_DBH_MIN | METRIC_DBH_MAX)) != 0;
+
+    const Accumulator EMPTY = {0, 0, INT_MAX, INT_MIN};
+    bool dense = groups <= DENSE_GROUPS;
+    vector<Accumulator> dense_groups(dense ? groups : 0, EMPTY);
+    unordered_map<long long, Accumulator> sparse_groups;
+
+    unsigned char keep[BLOCK];
+    long long     key[BLOCK];
+    int n = live.size();
+    for (int base = 0; base < n; base += BLOCK) {
+        int m = min(BLOCK, n - base);
+        const unsigned char *lv = &live[base];
+        const int *d = &dbh[base];
+        const int *z = &zipcode[base];
+        const int *sp = &species[base];
+        const unsigned char *b = &borough[base];
+        const unsigned char *h = &health[base];
+        const unsigned char *st = &status[base];
+
+        for (int i = 0; i < m; i++) {
+            keep[i] = lv[i] & species_ok[sp[i]]
+                    & (any_borough | (b[i] == want_borough))
+                    & (any_health | (h[i] == want_health))
+                    & (any_status | (st[i] == want_status))
+                    & (any_zipcode | (z[i] == filter.zipcode))
+                    & (d[i] >= min_dbh) & (d[i] <= max_dbh);
+            key[i] = 0;
+        }
+        for (size_t c = 0; c < group_by.size(); c++) {
+            long long r = cardinality(group_by[c]);
+            switch (group_by[c]) {
+                case GROUP_SPECIES: for (int i = 0; i < m; i++) key[i] = key[i] * r + sp[i]; break;
+                case GROUP_BOROUGH: for (int i = 0; i < m; i++) key[i] = key[i] * r + b[i];  break;
+                case GROUP_ZIPCODE: for (int i = 0; i < m; i++) key[i] = key[i] * r + z[i];  break;
+                case GROUP_HEALTH:  for (int i = 0; i < m; i++) key[i] = key[i] * r + h[i];  break;
+                case GROUP_STATUS:  for (int i = 0; i < m; i++) key[i] = key[i] * r + st[i]; break;
+            }
+        }
+
+        for (int i = 0; i < m; i++) {
+            if (!keep[i])
+                continue;
+            Accumulator *a;
+            if (dense) {
+                a = &dense_groups[key[i]];
+            }
+            else {
+                a = &sparse_groups.insert(make_pair(key[i], EMPTY)).first->second;
+            }
+            a->count++;
+            a->dbh_sum += d[i];
+            if (track_range) {
+                a->dbh_min = min(a->dbh_min, d[i]);
+                a->dbh_max = max(a->dbh_max, d[i]);
+            }
+        }
+    }
+
+    // decodes each non-empty group back into the values of its columns
+    vector<pair<long long, Accumulator> > found;
+    if (dense) {
+        for (long long g = 0; g < groups; g++)
+            if (dense_groups[g].count > 0)
+                found.push_back(make_pair(g, dense_groups[g]));
+    }
+    else {
+        found.assign(sparse_groups.begin(), sparse_groups.end());
+    }
+    for (size_t k = 0; k < found.size(); k++) {
+        const Accumulator & a = found[k].second;
+        AggregateRow row;
+        row.key.resize(group_by.size());
+        long long g = found[k].first;
+        for (size_t c = group_by.size(); c-- > 0; ) {
+            long long r = cardinality(group_by[c]);
+            row.key[c] = value(group_by[c], g % r);
+            g /= r;
+        }
+        row.count    = (metrics & METRIC_COUNT) ? a.count : 0;
+        row.dbh_sum  = (metrics & METRIC_DBH_SUM) ? a.dbh_sum : 0;
+        row.dbh_min  = (metrics & METRIC_DBH_MIN) ? a.dbh_min : 0;
+        row.dbh_max  = (metrics & METRIC_DBH_MAX) ? a.dbh_max : 0;
+        row.dbh_mean = (metrics & METRIC_DBH_MEAN) ? (double)a.dbh_sum / a.count : 0;
+        rows.push_back(row);
+    }
+    sort(rows.begin(), rows.end(), [](const AggregateRow & x, const AggregateRow & y) {
+        return x.key < y.key;
+    });
+    return rows;
+}
+
+// the number of codes a group-by column can take
+int TreeColumns::cardinality(GroupColumn column) const {
+    switch (column) {
+        case GROUP_SPECIES: return dictionary.size();
+        case GROUP_BOROUGH: return BOROUGHS + 1;    // trees without a borough group on their own
+        case GROUP_ZIPCODE: return ZIPCODES;
+        case GROUP_HEALTH:  return HEALTHS;
+        case GROUP_STATUS:  return STATUSES;
+    }
+    return 1;
+}
+
+// the value of a group-by column that code stands for
+string TreeColumns::value(GroupColumn column, int code) const {
+    char zip[8];
+    switch (column) {
+        case GROUP_SPECIES: return string(dictionary.name(code));
+        case GROUP_BOROUGH: return code < BOROUGHS ? BOROUGH_NAMES[code] : "";
+        case GROUP_ZIPCODE: snprintf(zip, sizeof(zip), "%05d", code); return zip;
+        case GROUP_HEALTH:  return HEALTH_NAMES[code];
+        case GROUP_STATUS:  return STATUS_NAMES[code];
+    }
+    return "";
+}
+
+const SpeciesDictionary & TreeColumns::species_dictionary() const {
+    return dictionary;
+}
+
+int TreeColumns::species_at(int slot) const {
+    return species[slot];
+}
+
+int TreeColumns::dbh_at(int slot) const {
+    return dbh[slot];
+}
+
+int TreeColumns::zipcode_at(int slot) const {
+    return zipcode[slot];
+}
+
+// makes every mark of this thread's scratch out of date, growing it to cover ids below species
+static void next_mark(int species) {
+    if ((int)scratch.mark.size() < species)
+        scratch.mark.resize(species + species / 2 + 16, 0);
+    if (++scratch.epoch == 0) {      // wrapped around; old marks could look current
+        fill(scratch.mark.begin(), scratch.mark.end(), 0);
+        scratch.epoch = 1;
+    }
+}
+
+// marks each folded id the first time pred accepts one of its trees, so out gets every id once
+template <class Pred>
+void TreeColumns::species_where(Pred pred, vector<int> & out) const {
+    out.clear();
+    next_mark(dictionary.size());
+    vector<unsigned> & mark = scratch.mark;
+    unsigned epoch = scratch.epoch;
+    int n = live.size();
+    for (int s = 0; s < n; s++) {
+        if (!live[s])
+            continue;
+        int id = dictionary.folded_id(species[s]);
+        if (mark[id] != epoch && pred(s)) {
+            mark[id] = epoch;
+            out.push_back(id);
+        }
+    }
+}
+
+void TreeColumns::species_in_zipcode(int zip, vector<int> & out) const {
+    species_where([&](int s) { return zipcode[s] == zip; }, out);
+}
+
+void TreeColumns::species_of(const vector<int> & slots, vector<int> & out) const {
+    out.clear();
+    next_mark(dictionary.size());
+    vector<unsigned> & mark = scratch.mark;
+    unsigned epoch = scratch.epoch;
+    for (size_t i = 0; i < slots.size(); i++) {
+        int id = dictionary.folded_id(species[slots[i]]);
+        if (mark[id] != epoch) {
+            mark[id] = epoch;
+            out.push_back(id);
+        }
+    }
+}
+
+int TreeColumns::count_species_of(const vector<int> & slots, bool estimate) const {
+    if (dictionary.size() <= EXACT_SPECIES) {
+        vector<uint64_t> & species_bits = scratch.bits;
+        species_bits.assign((dictionary.size() + 63) / 64, 0);
+        for (size_t i = 0; i < slots.size(); i++) {
+            int id = dictionary.folded_id(species[slots[i]]);
+            species_bits[id >> 6] |= 1ULL << (id & 63);
+        }
+        int count = 0;
+        for (size_t w = 0; w < species_bits.size(); w++)
+            count += __builtin_popcountll(species_bits[w]);
+        return count;
+    }
+    if (estimate) {
+        HyperLogLog & sketch = scratch.sketch;
+        sketch.clear();
+        for (size_t i = 0; i < slots.size(); i++)
+            sketch.add(dictionary.folded_id(species[slots[i]]));
+        return (int)(sketch.estimate() + 0.5);
+    }
+    vector<int> found;
+    species_of(slots, found);
+    return found.size();
+}
+
+void TreeColumns::matching_species(string_view partial_name, vector<int> & out) const {
+    out.clear();
+    char buf[SpeciesDictionary::MAX_NAME];
+    string_view part = SpeciesDictionary::fold(partial_name, buf);
+    if (part.data() == nullptr)
+        return;
+    for (int id = 0; id < dictionary.size(); id++) {
+        if (species_trees[id] > 0 && dictionary.folded(id).find(part) != string_view::npos)
+            out.push_back(id);
+    }
+}
+
+bool parse_group_by(const string & spec, vector<GroupColumn> & group_by) {
+    group_by.clear();
+    stringstream ss(spec);
+    string name;
+    while (getline(ss, name, ',')) {
+        name.erase(0, name.find_first_not_of(' '));
+        name.erase(name.find_last_not_of(' ') + 1);
+        name = SpeciesDictionary::fold(name);
+        if (name.empty())
+            continue;
+        int c = 0;
+        while (c <= GROUP_STATUS && COLUMN_NAMES[c] != name)
+            c++;
+        if (c > GROUP_STATUS)
+            return false;
+        group_by.push_back(GroupColumn(c));
+    }
+    return true;
+}
+
+void write_report(ostream & out, const vector<GroupColumn> & group_by, int metrics,
+                  const vector<AggregateRow> & rows) {
+    string separator = ",";
+    string line;
+    for (size_t c = 0; c < group_by.size(); c++)
+        line += COLUMN_NAMES[group_by[c]] + separator;
+    if (metrics & METRIC_COUNT)    line += "count" + separator;
+    if (metrics & METRIC_DBH_SUM)  line += "dbh_sum" + separator;
+    if (metrics & METRIC_DBH_MIN)  line += "dbh_min" + separator;
+    if (metrics & METRIC_DBH_MAX)  line += "dbh_max" + separator;
+    if (metrics & METRIC_DBH_MEAN) line += "dbh_mean" + separator;
+    if (!line.empty())
+        line.erase(line.size() - 1);
+    out << line << "\n";
+
+    for (size_t r = 0; r < rows.size(); r++) {
+        ostringstream row;
+        row.setf(ios::fixed);
+        row.precision(2);
+        for (size_t c = 0; c < rows[r].key.size(); c++)
+            row << rows[r].key[c] << separator;
+        if (metrics & METRIC_COUNT)    row << rows[r].count << separator;
+        if (metrics & METRIC_DBH_SUM)  row << rows[r].dbh_sum << separator;
+        if (metrics & METRIC_DBH_MIN)  row << rows[r].dbh_min << separator;
+        if (metrics & METRIC_DBH_MAX)  row << rows[r].dbh_max << separator;
+        if (metrics & METRIC_DBH_MEAN) row << rows[r].dbh_mean << separator;
+        line = row.str();
+        if (!line.empty())
+            line.erase(line.size() - 1);
+        out << line << "\n";
+    }
+}
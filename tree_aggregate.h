@@ -0,0 +1,205 @@
+/******************************************************************************
+Title : tree_aggregate.h
+Author : Yu Tong Chen
+Created on : 04/27/2019
+Description : The interface of TreeColumns, the fields of every stored tree
+              kept column by column, and of the group-by aggregation and
+              species queries that run over them.
+Usage : TreeCollection::aggregate(group_by, filter, metrics), then
+        write_report(out, group_by, metrics, rows) for the report command.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef TREE_AGGREGATE_H
+#define TREE_AGGREGATE_H
+#include "tree_schema.h"
+#include "species_dictionary.h"
+#include "hyper_log_log.h"
+#include <climits>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+using namespace std;
+
+class Tree;
+
+/** The columns a report can be grouped by */
+enum GroupColumn { GROUP_SPECIES, GROUP_BOROUGH, GROUP_ZIPCODE, GROUP_HEALTH,
+                   GROUP_STATUS };
+
+/** The metrics a report can ask for, or'ed together */
+enum Metric {
+    METRIC_COUNT    = 1,
+    METRIC_DBH_SUM  = 2,
+    METRIC_DBH_MIN  = 4,
+    METRIC_DBH_MAX  = 8,
+    METRIC_DBH_MEAN = 16,
+    METRIC_ALL      = 31
+};
+
+/** TreeFilter selects the trees a report covers. Every field left at its
+ *  default matches any tree.
+ */
+struct TreeFilter {
+    string  species;     // common name, case insensitive; empty for any
+    Borough borough;     // BOROUGHS for any
+    string  status;      // "Alive", "Dead", "Stump"; empty for any
+    string  health;      // "Good", "Fair", "Poor"; empty for any
+    int     zipcode;     // -1 for any
+    int     min_dbh;
+    int     max_dbh;
+
+    TreeFilter() : borough(BOROUGHS), zipcode(-1), min_dbh(0), max_dbh(INT_MAX) {}
+};
+
+/** One group of a report: the values of its group-by columns, in the order
+ *  they were asked for, and its metrics. Metrics that were not asked for
+ *  are left at 0.
+ */
+struct AggregateRow {
+    vector<string> key;
+    int            count;
+    long long      dbh_sum;
+    int            dbh_min;
+    int            dbh_max;
+    double         dbh_mean;
+};
+
+/** class TreeColumns
+ *  Holds the fields that reports group and filter on as one array per
+ *  field, indexed by the slot the collection stores the tree in. Text
+ *  fields are stored as small codes, so a report reads a few bytes per
+ *  tree and every comparison is an integer one.
+ */
+class TreeColumns {
+    public:
+        TreeColumns();
+
+        /** set(slot,t) stores the fields of t at slot, growing the columns
+         *  @param int  slot [in] the slot t is stored in
+         *  @param Tree t    [in] the tree
+         */
+        void set(int slot, const Tree & t);
+
+        /** clear(slot) marks slot as empty, so reports skip it */
+        void clear(int slot);
+
+        /** clear_all() empties every column */
+        void clear_all();
+
+        /** aggregate(g,f,m) groups the trees that pass f by the columns in g
+         * @notes
+         *       This is one pass over the columns, a block of slots at a
+         *       time: a branch-free loop computes each slot's group and
+         *       whether it passes f, and a second loop adds it to its
+         *       group. Groups are kept in a dense array when every
+         *       combination of the group-by values fits, and in a hash
+         *       table otherwise (species by zipcode, say).
+         * @param vector<GroupColumn> group_by [in] the columns to group by;
+         *        empty for one group holding every tree that passes
+         * @param TreeFilter filter  [in] which trees to count
+         * @param int        metrics [in] the Metric values to compute, or'ed
+         * @return vector<AggregateRow> the non-empty groups, sorted by key
+         */
+        vector<AggregateRow> aggregate(const vector<GroupColumn> & group_by,
+                                       const TreeFilter & filter,
+                                       int metrics) const;
+
+        /** species_dictionary() returns the names behind the species ids */
+        const SpeciesDictionary & species_dictionary() const;
+
+        /** species_at(slot) returns the species id of the tree in slot */
+        int species_at(int slot) const;
+
+        /** dbh_at(slot) returns the diameter of the tree in slot */
+        int dbh_at(int slot) const;
+
+        /** zipcode_at(slot) returns the zipcode of the tree in slot, 0 if it
+         *  is not one below ZIPCODES, as reports group and filter it
+         */
+        int zipcode_at(int slot) const;
+
+        /** The queries below write species ids into out, each id once, after
+         *  clearing it. Names that fold the same count as one species, under
+         *  its folded_id, and only species some tree still has are written.
+         *  Once out has grown to fit, they do not allocate. Their scratch
+         *  space is kept per thread, so they may run at once, but not
+         *  alongside set or clear.
+         */
+        void matching_species(string_view partial_name, vector<int> & out) const;
+        void species_in_zipcode(int zipcode, vector<int> & out) const;
+
+        /** species_of(slots,out) puts the species of the trees in slots,
+         *                       such as those ZOrderIndex::near finds
+         */
+        void species_of(const vector<int> & slots, vector<int> & out) const;
+
+        /** count_species_of(slots,e) returns how many distinct species the
+         *                           trees in slots have
+         * @notes
+         *       While there are at most EXACT_SPECIES species, each tree
+         *       sets the bit of its species and the answer is exact. Past
+         *       that, if estimate is true, the ids go into a HyperLogLog,
+         *       which is within a few percent; otherwise they are marked as
+         *       species_of does.
+         * @return int the number of species
+         */
+        int count_species_of(const vector<int> & slots, bool estimate = true) const;
+
+        // the most species counted exactly with a bitset, 8 KB of bits
+        static const int EXACT_SPECIES = 1 << 16;
+
+    private:
+        struct Accumulator {
+            int       count;
+            long long dbh_sum;
+            int       dbh_min;
+            int       dbh_max;
+        };
+
+        vector<unsigned char> live;       // 1 if the slot holds a tree
+        vector<int>           dbh;
+        vector<int>           zipcode;
+        vector<double>        latitude;
+        vector<double>        longitude;
+        vector<int>           species;    // id in dictionary
+        vector<unsigned char> borough;    // a Borough
+        vector<unsigned char> health;     // a Health
+        vector<unsigned char> status;     // a Status
+
+        SpeciesDictionary     dictionary;  // every name seen, never shrinks
+        vector<int>           species_trees;   // live trees by the folded_id of their species
+
+        template <class Pred>
+        void species_where(Pred pred, vector<int> & out) const;
+
+        int cardinality(GroupColumn column) const;
+        string value(GroupColumn column, int code) const;
+};
+
+
+/** parse_group_by(s,g) reads a comma separated list of column names
+ *  ("species", "borough", "zipcode", "health", "status")
+ *  @param string              spec     [in]  the list, such as "borough,status"
+ *  @param vector<GroupColumn> group_by [out] the columns
+ *  @return bool false if a name is not a column
+ */
+bool parse_group_by(const string & spec, vector<GroupColumn> & group_by);
+
+/** write_report(out,g,m,rows) writes rows as csv, with a header line naming
+ *  the group-by columns and then the metrics in m
+ *  @param ostream&             out      [in,out] the stream to write to
+ *  @param vector<GroupColumn>  group_by [in] the columns rows were grouped by
+ *  @param int                  metrics  [in] the metrics to write
+ *  @param vector<AggregateRow> rows     [in] what aggregate returned
+ */
+void write_report(ostream & out, const vector<GroupColumn> & group_by, int metrics,
+                  const vector<AggregateRow> & rows);
+
+
+#endif //TREE_AGGREGATE_H
@@ -11,23 +11,13 @@ Modifications:
 
 
 #include "tree_collection.h"
+#include "change_log.h"
+#include <algorithm>
+#include <climits>
 #include <cmath>
 
-// helper function to convert a string to lowercase removing hyphens
-string hyphenLower(string s) {
-    string new_str;
-
-    for (int i = 0; i < s.length(); i++) {
-        new_str+=tolower(s[i]);
-    }
-
-    for(int j = 0; j<new_str.length(); j++) {
-        if(new_str[j]=='-')
-            new_str[j] = ' ';
-    }
-
-    return new_str;
-}
+// the most words of found-species bits the batch get_all_near keeps at once, 32 MB
+static const size_t JOIN_WORDS = 1 << 22;
 
 /* calculate the distance between two distance on sphere (The Haversine Formula)
  * Used to compute the approximate distance between two points when they are each defined by their decimal latitude
@@ -49,288 +39,759 @@ double haversine(double lat1, double lon1, double lat2, double lon2) {
 }
 
 // default constructor
-TreeCollection::TreeCollection():root(nullptr){
+TreeCollection::TreeCollection():root(nullptr), frozen_mode(false), bulk_mode(false), versioned(false), change_log(nullptr), compact_every(0), replaying(false), tree_count(0){
+    for(int i = 0; i < BOROUGHS; i++) {
+        boroughs[i].name = BOROUGH_NAMES[i];
+        boroughs[i].count = 0;
+    }
 }
 
 //constructor
-TreeCollection::TreeCollection(Tree & new_tree):AvlTree(new_tree){
+TreeCollection::TreeCollection(Tree & new_tree):AvlTree(new_tree), frozen_mode(false), bulk_mode(false), versioned(false), change_log(nullptr), compact_every(0), replaying(false), tree_count(0){
+    for(int i = 0; i < BOROUGHS; i++) {
+        boroughs[i].name = BOROUGH_NAMES[i];
+        boroughs[i].count = 0;
+    }
     add_tree(new_tree);
 }
 
 //destructor
 TreeCollection::~TreeCollection()  {
     makeEmpty();
+    delete change_log;
 }
 
-// return total number of trees
+// return total number of trees, those without a borough included, as count_of_tree_species counts them
 int TreeCollection::total_tree_count() {
-    int count = 0;
-    for(int i = 0; i < 5; i++) {
-        count += boroughs[i].count;
-    }
-    return count;
+    return live_slots.cardinality();
 }
 
 // return total number of tree_species
 int TreeCollection::count_of_tree_species ( const string & species_name ) {
-    list<string> list_species = traverseSpecies(root, species_name);
-    if(list_species.size() == 0)
-        return 0;
-
-    return list_species.size();
+    string name = SpeciesDictionary::fold(species_name);
+    if(frozen_mode) {
+        /* the trees of a spelling lie between ids INT_MIN and INT_MAX of that name; Tree compares names
+         * in lower case but keeps hyphens, so every spelling that folds to name is counted, once per
+         * spelling in lower case
+         */
+        int count = 0;
+        vector<Tree> counted;
+        for(auto & i : list_of_species) {
+            if(!SpeciesDictionary::folds_to(i.first, name))
+                continue;
+            Tree lo(INT_MIN, 0, "", "", i.first, 0, "", "", 0, 0);
+            if(std::find(counted.begin(), counted.end(), lo) != counted.end())
+                continue;
+            counted.push_back(lo);
+            Tree hi(INT_MAX, 0, "", "", i.first, 0, "", "", 0, 0);
+            frozen.for_each_in_range(lo, hi, [&count](const Tree &) { count++; });
+        }
+        return count;
+    }
+    return reduce_trees(0,
+        [&name](const Tree & t) { return SpeciesDictionary::folds_to(t.common_name(), name) ? 1 : 0; },
+        [](int a, int b) { return a + b; });
 }
 
-// return total number of tree specie sin specified boro
+// return total number of tree species in specified boro; the borough is compared as a Borough
 int TreeCollection::count_of_tree_species_in_boro ( const string & species_name,
                                     const string & boro_name ) {
-    return traverseSpeciesBoro(root, species_name, boro_name);
+    Borough b = borough_named(boro_name);
+    if(b == BOROUGHS)
+        return 0;
+    string name = SpeciesDictionary::fold(species_name);
+    return reduce_trees(0,
+        [&](const Tree & t) { return t.borough() == b && SpeciesDictionary::folds_to(t.common_name(), name) ? 1 : 0; },
+        [](int a, int b) { return a + b; });
 }
 
 
 // return the total number of trees all the boros combined
 int TreeCollection::get_counts_of_trees_by_boro ( const string & species_name,
                                   boro  tree_count[5] ) {
+    typedef array<int, BOROUGHS + 1> Counts;   // the extra counter takes trees without a borough
+    string name = SpeciesDictionary::fold(species_name);
+    Counts counts = reduce_trees(Counts(),
+        [&name](const Tree & t) {
+            Counts c = Counts();
+            if(SpeciesDictionary::folds_to(t.common_name(), name))
+                c[t.borough()] = 1;
+            return c;
+        },
+        [](Counts a, const Counts & b) {
+            for(int i = 0; i <= BOROUGHS; i++)
+                a[i] += b[i];
+            return a;
+        });
     int total_count = 0;
-    tree_count[5] =  traverseSpeciesByBoro(root, species_name);
-    for(int i = 0; i < 5; i++) {
-        total_count += tree_count[i].count;
+    for(int i = 0; i < BOROUGHS; i++) {
+        tree_count[i].count = counts[i];
+        total_count += counts[i];
     }
     return total_count;
 }
 
-// return total number of trees in boro
+// return total number of trees in boro, which add_tree and remove_tree keep counted
 int TreeCollection::count_of_trees_in_boro( const string & boro_name ) {
-    return traverseBoro(root, boro_name);
+    Borough b = borough_named(boro_name);
+    return b == BOROUGHS ? 0 : boroughs[b].count;
 }
 
 /* Adds into the collection of trees, updates list of species name, count of trees and types of trees in borough
- * hard coded specific values for each borough as recommeneded by Professor Weiss
-borough[0] = Manhattan, borough[1] = Bronx, borough[2] = Brooklyn, borough[3] = Queens, borough[4] = Staten Island
+ * boroughs[] is indexed by the tree's Borough: borough[0] = Manhattan, borough[1] = Bronx, borough[2] = Brooklyn,
+ * borough[3] = Queens, borough[4] = Staten Island
  */
 int TreeCollection::add_tree( Tree & new_tree) {
+    if(by_id.find(new_tree.id()) >= 0)
+        return 0;
+    if(!log_change(ChangeLog::ADD, new_tree))
+        return 0;
+    thaw();
     collection.insert(new_tree);
-    bool find = false;
-    for(auto &i : list_of_species) {
-        if(i == new_tree.common_name()) {
-            find = true;
-        }
-        if(!find) {
-            list_of_species.insert((new_tree.common_name()));
-            tree_count++;       // keeps track of distinct species added
-            if(new_tree.borough_name() == "Manhattan") {
-                boroughs[0].count++;
-            }
-            else if(new_tree.borough_name() == "Bronx"){
-                boroughs[1].count++;
-            }
-            else if(new_tree.borough_name() == "Brooklyn") {
-                boroughs[2].count++;
-            }
-            else if(new_tree.borough_name() == "Queens"){
-                boroughs[3].count++;
-            }
-            else if(new_tree.borough_name() == "Staten Island") {
-                boroughs[4].count++;
-            }
+    if(versioned)
+        versions.insert(new_tree);
+    store_slot(new_tree, bulk_mode ? nullptr : &collection.find(new_tree));
+    if(change_log != nullptr && !replaying && compact_every > 0 && change_log->records() >= compact_every)
+        compact_log();
+    if(++list_of_species[new_tree.common_name()] == 1)
+        tree_count++;       // keeps track of distinct species added
+    if(new_tree.borough() != BOROUGHS)
+        boroughs[new_tree.borough()].count++;
+    return 1;
+}
+
+/* Removes from the collection of trees and updates the count of trees in its borough and of its species
+ * the borough is read from the stored tree, since old_tree only needs to carry the key
+ */
+int TreeCollection::remove_tree( const Tree & old_tree) {
+    if(by_id.find(old_tree.id()) < 0 || !(find_tree(old_tree) == old_tree))
+        return 0;
+    if(!log_change(ChangeLog::REMOVE, old_tree))
+        return 0;
+    thaw();
+    release_slot(by_id.find(old_tree.id()), find_tree(old_tree));
+    collection.remove(old_tree);
+    if(versioned)
+        versions.remove(old_tree);
+    if(change_log != nullptr && !replaying && compact_every > 0 && change_log->records() >= compact_every)
+        compact_log();
+    return 1;
+}
+
+/* moves every tree of other into this collection and leaves other empty; a tree whose id is
+ * already here stays out, as add_tree would refuse it. The search trees and version trees are
+ * merged in linear passes, and the species set and borough counts are added rather than recounted;
+ * only the per-slot indexes take the trees one at a time. The merged trees are written to this
+ * collection's log, if open; other's log is not written.
+ */
+int TreeCollection::merge(TreeCollection && other) {
+    if(&other == this)
+        return 0;
+    thaw();
+    other.thaw();
+    vector<const Tree *> trees;     // other's trees that come over
+    vector<int> dropped;            // and the slots of those that do not
+    other.live_slots.for_each([&](int slot) {
+        if(by_id.find(other.slot_ids[slot]) < 0)
+            trees.push_back(&other.tree_at(slot));
+        else
+            dropped.push_back(slot);
+    });
+    if(change_log != nullptr && !replaying && !change_log->append(ChangeLog::ADD, trees))
+        return -1;
+    for(size_t i = 0; i < dropped.size(); i++) {
+        const Tree & t = other.tree_at(dropped[i]);
+        other.list_of_species[t.common_name()]--;
+        if(t.borough() != BOROUGHS)
+            other.boroughs[t.borough()].count--;
+        other.collection.remove(other.slot_key(dropped[i]));
+    }
+    if(versioned) {
+        // the trees that come over, as a version tree of their own, merged into ours
+        vector<const Tree *> sorted(trees);
+        std::sort(sorted.begin(), sorted.end(), [](const Tree *a, const Tree *b) { return *a < *b; });
+        PersistentAvlTree<Tree> incoming;
+        incoming.assign(sorted);
+        versions.merge(incoming);
+    }
+    collection.merge(other.collection);
+    for(size_t i = 0; i < trees.size(); i++)
+        store_slot(*trees[i], trees[i]);    // the same item, in collection now
+    for(auto & name : other.list_of_species) {
+        if(name.second > 0 && (list_of_species[name.first] += name.second) == name.second)
+            tree_count++;
+    }
+    for(int b = 0; b < BOROUGHS; b++)
+        boroughs[b].count += other.boroughs[b].count;
+    if(change_log != nullptr && !replaying && compact_every > 0 && change_log->records() >= compact_every)
+        compact_log();
+    other.clear_trees();
+    return trees.size();
+}
+
+// the trees of a species are those from (name, any id) up to, not including, the next possible name
+vector<Tree> TreeCollection::extract_species(const string & species_name) {
+    Tree lo(INT_MIN, 0, "", "", species_name, 0, "", "", 0, 0);
+    Tree hi(INT_MIN, 0, "", "", species_name + '\0', 0, "", "", 0, 0);
+    vector<Tree> taken;
+    take_range(lo, hi, &taken);
+    return taken;
+}
+
+int TreeCollection::erase_range(const Tree & lo, const Tree & hi) {
+    return take_range(lo, hi, nullptr);
+}
+
+/* cuts the trees in [lo, hi) out of the search tree and the version tree with splits and joins,
+ * then frees their slots one by one; copies them to taken unless it is nullptr
+ */
+int TreeCollection::take_range(const Tree & lo, const Tree & hi, vector<Tree> * taken) {
+    if(!(lo < hi))
+        return 0;
+    thaw();
+    TreeStore range;
+    collection.extract(lo, hi, range);
+    if(change_log != nullptr && !replaying) {
+        vector<const Tree *> trees;
+        range.for_each([&trees](const Tree & t) { trees.push_back(&t); });
+        if(!change_log->append(ChangeLog::REMOVE, trees)) {
+            collection.merge(range);    // puts back the same items, so the slots still point at them
+            return 0;
         }
     }
+    if(versioned)
+        versions.remove_range(lo, hi);
+    int removed = 0;
+    range.for_each([&](const Tree & t) {
+        if(taken != nullptr)
+            taken->push_back(t);
+        release_slot(by_id.find(t.id()), t);
+        removed++;
+    });
+    if(change_log != nullptr && !replaying && compact_every > 0 && change_log->records() >= compact_every)
+        compact_log();
+    return removed;
+}
 
+// writes op on t to the open log, unless there is none or it is being replayed; false if that fails
+bool TreeCollection::log_change(int op, const Tree & t) {
+    return change_log == nullptr || replaying || change_log->append(ChangeLog::Operation(op), t);
 }
 
-// print all species collection to out file
-void TreeCollection::print_all_species(ostream & out) const {
-    set<string> all_species = traverseAll(root);
-    for(auto &i : all_species)
-        out << i;
+// starts appending every add_tree and remove_tree to the log at log_path
+bool TreeCollection::open_log(const string & log_path, int compact_every) {
+    delete change_log;
+    change_log = new ChangeLog();
+    snapshot_path = log_path + ".snap";
+    this->compact_every = compact_every;
+    if(!change_log->open(log_path)) {
+        delete change_log;
+        change_log = nullptr;
+        return false;
+    }
+    return true;
 }
 
-// prints whole collection of trees to out file
-void TreeCollection::print(ostream & out ) const {
+// replays every intact record of log_path without logging it again
+int TreeCollection::apply_log(const string & log_path) {
+    replaying = change_log != nullptr && (log_path == change_log->path() || log_path == snapshot_path);
+    int applied = ChangeLog::replay(log_path, [this](ChangeLog::Operation op, const Tree & t) {
+        if(op == ChangeLog::ADD) {
+            Tree new_tree(t);
+            add_tree(new_tree);
+        }
+        else {
+            remove_tree(t);
+        }
+    });
+    replaying = false;
+    return applied;
+}
 
+/* writes the collection to the snapshot file, then empties the log
+ * a crash between the two leaves records that are already in the snapshot, and replaying them again is harmless
+ */
+bool TreeCollection::compact_log() {
+    if(change_log == nullptr)
+        return false;
+    vector<const Tree *> sorted;
+    sorted_trees(sorted);
+    return ChangeLog::write_snapshot(snapshot_path, sorted) && change_log->clear();
 }
 
-// returns a list of species in the collectioin that partially matches input
-list<string> TreeCollection::get_matching_species(const string & species_name) const {
-    list<string> species_match = traverseMatch(root, species_name);
-    return species_match;
+// moves the trees out of the search tree into the read-only array
+void TreeCollection::freeze() {
+    if(frozen_mode)
+        return;
+    vector<Tree> sorted;
+    sorted.reserve(live_slots.cardinality());
+    collection.for_each([&sorted](const Tree & t) { sorted.push_back(t); });
+    frozen.build(sorted);
+    collection.makeEmpty();
+    frozen_mode = true;
+    point_slots();
 }
 
-// returns a list of all common tree species located around given zipcode, no duplicates
-list<string> TreeCollection::get_all_in_zipcode(int zipcode) const {
-    list<string> zip_common = travereseSpecieZipcode(root, zipcode);
-    return zip_common;
+bool TreeCollection::is_frozen() const {
+    return frozen_mode;
 }
 
-// returns a list of all species within a given distance from GPS location
-list<string> TreeCollection::get_all_near(double latitude, double longitude,
-                          double  distance) const {
-    list<string> common_within = traverseAllInZip(root,latitude,longitude,distance);
-    return common_within;
+void TreeCollection::begin_bulk() {
+    thaw();
+    collection.begin_bulk();
+    bulk_mode = true;
+}
+
+void TreeCollection::end_bulk() {
+    collection.end_bulk();
+    bulk_mode = false;
+    point_slots();
+}
+
+// looks the key up in whichever layout currently holds the trees
+const Tree & TreeCollection::find_tree( const Tree & key ) const {
+    return frozen_mode ? frozen.find(key) : collection.find(key);
+}
 
+// the key orders by name and id only, so the other fields are left empty
+Tree TreeCollection::slot_key(int slot) const {
+    return Tree(slot_ids[slot], 0, "", "", string(species_name(columns.species_at(slot))), 0, "", "", 0, 0);
 }
 
-/* helper for print_all_tree_species
- * returns a list of all trees species in collection
+// the tree a slot points at, or, for a tree staged by begin_bulk, the one found by its key
+const Tree & TreeCollection::tree_at(int slot) const {
+    const Tree * t = slot_trees[slot];
+    return t != nullptr ? *t : find_tree(slot_key(slot));
+}
+
+/* a search tree keeps each tree at one address until it is removed, and frozen until thaw,
+ * so the slots are pointed again only when the trees change layout; staged trees have none yet
  */
-list<string> TreeCollection::traverseSpecies(AvlNode<Tree> *t, const string &species) {
-    list<string> list_species;
-    if (t != nullptr) {
-        traverseSpecies(t->left, species);
-        if(hyphenLower(t->element.common_name()) == hyphenLower(species)) {
-            list_species.push_back(hyphenLower(species));
-        }
-        traverseSpecies(t->right, species);
+void TreeCollection::point_slots() {
+    if(bulk_mode) {
+        fill(slot_trees.begin(), slot_trees.end(), nullptr);
+        return;
     }
-    return list_species;
+    auto point = [this](const Tree & t) { slot_trees[by_id.find(t.id())] = &t; };
+    if(frozen_mode)
+        frozen.for_each(point);
+    else
+        collection.for_each(point);
 }
 
+// returned by get_tree_by_id when no tree has the id
+static const Tree NO_TREE;
 
-/* helper for print_all_species to print_all that traverses collection and appends to a sorted data structure
- * returns an ordered set of all trees in collection
- */
-set<string> TreeCollection::traverseAll(AvlNode<Tree> *t) const {
-    set<string> all_species;
-    if (t != nullptr) {
-        traverseAll(t->left);
-        all_species.insert(t->element.common_name());
-        traverseAll(t->right);
+const Tree & TreeCollection::get_tree_by_id( int id ) const {
+    int slot = by_id.find(id);
+    return slot < 0 ? NO_TREE : tree_at(slot);
+}
+
+vector<AggregateRow> TreeCollection::aggregate(const vector<GroupColumn> & group_by,
+                                               const TreeFilter & filter, int metrics) const {
+    return columns.aggregate(group_by, filter, metrics);
+}
+
+int TreeCollection::count_in_dbh_range(int lo, int hi, const string & boro_name) const {
+    Borough b = boro_name.empty() ? BOROUGHS : borough_named(boro_name);
+    if(!boro_name.empty() && b == BOROUGHS)
+        return 0;
+    return by_dbh.count(lo, hi, b);
+}
+
+// the index shares one bucket among the largest diameters, so each tree is checked against hi as well
+vector<Tree> TreeCollection::get_all_in_dbh_range(int lo, int hi, const string & boro_name) const {
+    vector<Tree> found;
+    Borough b = boro_name.empty() ? BOROUGHS : borough_named(boro_name);
+    if(!boro_name.empty() && b == BOROUGHS)
+        return found;
+    vector<int> in_range;
+    by_dbh.slots(lo, hi, b, in_range);
+    found.reserve(in_range.size());
+    for(size_t i = 0; i < in_range.size(); i++) {
+        int dbh = columns.dbh_at(in_range[i]);
+        if(dbh >= lo && dbh <= hi)
+            found.push_back(tree_at(in_range[i]));
     }
-    return all_species;
+    return found;
 }
 
+int TreeCollection::dbh_quantile(double q, const string & species_name) const {
+    if(species_name.empty())
+        return by_dbh.quantile(q);
+    int species = columns.species_dictionary().lookup(species_name);
+    return species < 0 ? -1 : by_dbh.quantile(q, species);
+}
 
-/* helper for get_matching_species to traverse tree and find matching species
- * returns a list of species that match given partial string
- */
-list<string> TreeCollection::traverseMatch(AvlNode<Tree> *t, const string &species) const{
-    list<string> list_species;
-    if (t != nullptr) {
-        traverseMatch(t->left, species);
-        if(hyphenLower(t->element.common_name()).find(hyphenLower(species)) != string::npos) {
-            for(auto &i : list_species) {
-                if( hyphenLower(i) != hyphenLower(species))
-                    list_species.push_back(hyphenLower(t->element.common_name()));
-            }
-        }
-        traverseMatch(t->right, species);
+int TreeCollection::species_id(string_view species_name) const {
+    return columns.species_dictionary().lookup(species_name);
+}
+
+string_view TreeCollection::species_name(int id) const {
+    return columns.species_dictionary().name(id);
+}
+
+void TreeCollection::get_matching_species(string_view species_name, vector<int> & ids) const {
+    columns.matching_species(species_name, ids);
+}
+
+// the slots a spatial query finds; one per thread, so the queries can run at once without allocating
+static thread_local vector<int> found_slots;
+
+void TreeCollection::get_all_in_zipcode(int zipcode, vector<int> & ids) const {
+    columns.species_in_zipcode(zipcode, ids);
+}
+
+void TreeCollection::get_all_near(double latitude, double longitude, double distance,
+                                  vector<int> & ids) const {
+    by_position.near(latitude, longitude, distance, found_slots);
+    columns.species_of(found_slots, ids);
+}
+
+int TreeCollection::count_species_near(double latitude, double longitude, double distance,
+                                       bool estimate) const {
+    by_position.near(latitude, longitude, distance, found_slots);
+    return columns.count_species_of(found_slots, estimate);
+}
+
+// returned by slots_with for a value that no tree can have
+static const SlotBitmap NO_SLOTS;
+
+const SlotBitmap & TreeCollection::slots_with(Status status) const {
+    return (status >= 0 && status < STATUSES) ? status_slots[status] : NO_SLOTS;
+}
+
+const SlotBitmap & TreeCollection::slots_with(Health health) const {
+    return (health >= 0 && health < HEALTHS) ? health_slots[health] : NO_SLOTS;
+}
+
+const SlotBitmap & TreeCollection::slots_with(Borough borough) const {
+    return (borough >= 0 && borough < BOROUGHS) ? borough_slots[borough] : NO_SLOTS;
+}
+
+const SlotBitmap & TreeCollection::all_slots() const {
+    return live_slots;
+}
+
+SlotBitmap TreeCollection::slots_matching(const TreeFilter & filter) const {
+    SlotBitmap matching = live_slots;
+    if(filter.borough != BOROUGHS)
+        matching = matching & slots_with(filter.borough);
+    if(!filter.status.empty())
+        matching = matching & slots_with(status_of(filter.status));
+    if(!filter.health.empty())
+        matching = matching & slots_with(health_of(filter.health));
+
+    if(filter.species.empty() && filter.zipcode < 0 && filter.min_dbh <= 0 && filter.max_dbh == INT_MAX)
+        return matching;
+    string name = SpeciesDictionary::fold(filter.species);
+    const SpeciesDictionary & dictionary = columns.species_dictionary();
+    SlotBitmap checked;
+    matching.for_each([&](int slot) {
+        int dbh = columns.dbh_at(slot);
+        if((filter.species.empty() || dictionary.folded(columns.species_at(slot)) == name)
+                && (filter.zipcode < 0 || columns.zipcode_at(slot) == filter.zipcode)
+                && dbh >= filter.min_dbh && dbh <= filter.max_dbh)
+            checked.add(slot);
+    });
+    return checked;
+}
+
+vector<Tree> TreeCollection::get_trees(const SlotBitmap & s) const {
+    vector<Tree> found;
+    found.reserve(s.cardinality());
+    s.for_each([&](int slot) { found.push_back(tree_at(slot)); });
+    return found;
+}
+
+// a status or health that is not valid is indexed as the empty one
+void TreeCollection::index_slot(int slot, const Tree & t, bool present) {
+    Status status = status_of(t.life_status());
+    Health health = health_of(t.tree_health());
+    SlotBitmap *sets[4] = {
+        &live_slots,
+        &status_slots[status == STATUSES ? STATUS_NONE : status],
+        &health_slots[health == HEALTHS ? HEALTH_NONE : health],
+        t.borough() == BOROUGHS ? nullptr : &borough_slots[t.borough()]
+    };
+    for(int i = 0; i < 4; i++) {
+        if(sets[i] == nullptr)
+            continue;
+        if(present)
+            sets[i]->add(slot);
+        else
+            sets[i]->remove(slot);
     }
-    return list_species;
 }
 
-/* helper for count_of_trees_in_boro
- * returns a list of trees in a given boro
- */
-int TreeCollection::traverseBoro(AvlNode<Tree> *t, const string&boro) {
-    int count_tree_boros;
-    if (t != nullptr) {
-        traverseMatch(t->left, boro);
-        if(hyphenLower(t->element.borough_name()) == hyphenLower(boro)) {
-            count_tree_boros++;
-        }
-        traverseMatch(t->right, boro);
+// the species id is read from columns, so this runs after columns.set and before columns.clear
+void TreeCollection::rank_slot(int slot, const Tree & t, bool present) {
+    SpeciesRanking *rankings[3] = {
+        &city_ranking,
+        t.borough() == BOROUGHS ? nullptr : &borough_ranking[t.borough()],
+        &zipcode_ranking[t.zip_code()]
+    };
+    // ranked by the folded id, so spellings that differ only in case or
+    // hyphens count as one species, as count_species_of counts them
+    int id = columns.species_dictionary().folded_id(columns.species_at(slot));
+    for(int i = 0; i < 3; i++) {
+        if(rankings[i] == nullptr)
+            continue;
+        if(present)
+            rankings[i]->add(id);
+        else
+            rankings[i]->remove(id);
     }
-    return count_tree_boros;
 }
 
+vector<pair<string, int> > TreeCollection::top_species(int n, const string & boro_name) const {
+    if(boro_name.empty())
+        return top_of(city_ranking, n);
+    Borough b = borough_named(boro_name);
+    if(b == BOROUGHS)
+        return vector<pair<string, int> >();
+    return top_of(borough_ranking[b], n);
+}
+
+vector<pair<string, int> > TreeCollection::top_species_in_zipcode(int n, int zipcode) const {
+    unordered_map<int, SpeciesRanking>::const_iterator it = zipcode_ranking.find(zipcode);
+    if(it == zipcode_ranking.end())
+        return vector<pair<string, int> >();
+    return top_of(it->second, n);
+}
 
-/* helper for count_of_tree_species_in_boro
- * returns a list of species in a given boro
+vector<pair<string, int> > TreeCollection::top_of(const SpeciesRanking & ranking, int n) const {
+    vector<pair<int, int> > ids;
+    ranking.top(n, ids);
+    vector<pair<string, int> > top(ids.size());
+    for(size_t i = 0; i < ids.size(); i++)
+        top[i] = make_pair(string(species_name(ids[i].first)), ids[i].second);
+    return top;
+}
+
+// the tree is copied out of its slot first, as remove_tree frees the one in the collection
+int TreeCollection::remove_tree_by_id( int id ) {
+    int slot = by_id.find(id);
+    if(slot < 0)
+        return 0;
+    Tree old_tree(tree_at(slot));
+    return remove_tree(old_tree);
+}
+
+// puts t in a free slot and in every per-slot index; returns the slot
+int TreeCollection::store_slot(const Tree & t, const Tree * stored) {
+    int slot;
+    if(free_slots.empty()) {
+        slot = slot_ids.size();
+        slot_ids.push_back(t.id());
+        slot_trees.push_back(stored);
+    }
+    else {
+        slot = free_slots.back();
+        free_slots.pop_back();
+        slot_ids[slot] = t.id();
+        slot_trees[slot] = stored;
+    }
+    by_id.insert(t.id(), slot);
+    columns.set(slot, t);
+    by_dbh.insert(slot, t, columns.species_dictionary().folded_id(columns.species_at(slot)));
+    double latitude, longitude;
+    t.get_position(latitude, longitude);
+    by_position.insert(slot, latitude, longitude);
+    index_slot(slot, t, true);
+    rank_slot(slot, t, true);
+    return slot;
+}
+
+/* takes t, the tree at slot, out of every per-slot index, the borough counts and the species counts,
+ * and frees the slot; a species with no trees left is dropped from list_of_species
  */
-int TreeCollection::traverseSpeciesBoro(AvlNode<Tree> *t, const string&species, const string&boro) {
-    int species_boro_count;
-    if (t != nullptr) {
-        traverseSpeciesBoro(t->left, species, boro);
-        if(hyphenLower(t->element.borough_name()) == hyphenLower(boro) && hyphenLower(t->element.common_name()) == hyphenLower(species)) {
-            species_boro_count++;
-        }
-        traverseSpeciesBoro(t->right, species, boro);
+void TreeCollection::release_slot(int slot, const Tree & t) {
+    if(t.borough() != BOROUGHS)
+        boroughs[t.borough()].count--;
+    map<string, int>::iterator species = list_of_species.find(t.common_name());
+    if(--species->second == 0) {
+        list_of_species.erase(species);
+        tree_count--;
     }
-    return species_boro_count;
-}
-
-/* helper for count_of_tree_species_by_boro
- * returns array of number of species in each borough
-*/
-boro TreeCollection::traverseSpeciesByBoro(AvlNode<Tree> *t, const string&species) {
-    boro species_boroughs[5];
-    //borough[0] = Manhattan, borough[1] = Bronx, borough[2] = Brooklyn, borough[3] = Queens, borough[4] = Staten Island
-    // hard coded specific values for each borough as recommeneded by Professor Weiss
-    int manhattan_count = 0, bronx_count = 0, brooklyn_count = 0, queens_count = 0, statenisland_count = 0;
-
-    if (t != nullptr) {
-        traverseSpeciesByBoro(t->left, species);
-        if(hyphenLower(t->element.borough_name()) == hyphenLower("Manhattan") && hyphenLower(t->element.common_name()) == hyphenLower(species)) {
-            manhattan_count++;
-            species_boroughs[0].count = manhattan_count;
-            species_boroughs[0].name = hyphenLower(species);
-        }
-        else if(hyphenLower(t->element.borough_name()) == hyphenLower("Bronx") && hyphenLower(t->element.common_name()) == hyphenLower(species)) {
-            bronx_count++;
-            species_boroughs[1].count = bronx_count;
-            species_boroughs[1].name = hyphenLower(species);
-        }
-        else if(hyphenLower(t->element.borough_name()) == hyphenLower("Brooklyn") && hyphenLower(t->element.common_name()) == hyphenLower(species)) {
-            brooklyn_count++;
-            species_boroughs[2].count = brooklyn_count;
-            species_boroughs[2].name = hyphenLower(species);
-        }
-        else if(hyphenLower(t->element.borough_name()) == hyphenLower("Queens") && hyphenLower(t->element.common_name()) == hyphenLower(species)) {
-            queens_count++;
-            species_boroughs[3].count = queens_count;
-            species_boroughs[3].name = hyphenLower(species);
-        }
-        else if(hyphenLower(t->element.borough_name()) == hyphenLower("Staten Island") && hyphenLower(t->element.common_name()) == hyphenLower(species)) {
-            statenisland_count++;
-            species_boroughs[4].count = statenisland_count;
-            species_boroughs[4].name = hyphenLower(species);
-        }
+    index_slot(slot, t, false);
+    rank_slot(slot, t, false);
+    by_id.erase(t.id());
+    columns.clear(slot);
+    by_dbh.remove(slot);
+    by_position.remove(slot);
+    slot_trees[slot] = nullptr;
+    free_slots.push_back(slot);
+}
 
-        traverseSpeciesByBoro(t->right, species);
+// empties every structure that holds trees, as merge leaves the collection it took them from
+void TreeCollection::clear_trees() {
+    collection.makeEmpty();
+    frozen.makeEmpty();
+    frozen_mode = false;
+    versions.makeEmpty();
+    versioned = false;
+    slot_ids.clear();
+    slot_trees.clear();
+    free_slots.clear();
+    by_id.clear();
+    columns.clear_all();
+    by_dbh.clear();
+    by_position.clear();
+    live_slots.clear();
+    for(int i = 0; i < STATUSES; i++)
+        status_slots[i].clear();
+    for(int i = 0; i < HEALTHS; i++)
+        health_slots[i].clear();
+    for(int i = 0; i < BOROUGHS; i++) {
+        borough_slots[i].clear();
+        borough_ranking[i].clear();
+        boroughs[i].count = 0;
     }
-    return species_boroughs[5];
+    city_ranking.clear();
+    zipcode_ranking.clear();
+    list_of_species.clear();
+    tree_count = 0;
+}
+
+// undoes freeze() before a change; does nothing if the collection is not frozen
+void TreeCollection::thaw() {
+    if(!frozen_mode)
+        return;
+    if(!bulk_mode)      // the trees come out sorted, so one bulk merge places them all
+        collection.begin_bulk();
+    frozen.for_each([this](const Tree & t) { collection.insert(t); });
+    if(!bulk_mode)
+        collection.end_bulk();
+    frozen.makeEmpty();
+    frozen_mode = false;
+    point_slots();
 }
 
-/* helper for get_all_in_zip
- * returns a list of species in a given zipcode
+// print all species collection to out file
+void TreeCollection::print_all_species(ostream & out) const {
+    for(auto &i : list_of_species)
+        out << i.first << endl;
+}
+
+// prints whole collection of trees to out file
+void TreeCollection::print(ostream & out ) const {
+
+}
+
+// returns a list of species in the collectioin that partially matches input
+list<string> TreeCollection::get_matching_species(const string & species_name) const {
+    vector<int> ids;
+    get_matching_species(species_name, ids);
+    return species_names(ids);
+}
+
+// returns a list of all common tree species located around given zipcode, no duplicates
+list<string> TreeCollection::get_all_in_zipcode(int zipcode) const {
+    vector<int> ids;
+    get_all_in_zipcode(zipcode, ids);
+    return species_names(ids);
+}
+
+// returns a list of all species within a given distance from GPS location, no duplicates
+list<string> TreeCollection::get_all_near(double latitude, double longitude,
+                          double  distance) const {
+    vector<int> ids;
+    get_all_near(latitude, longitude, distance, ids);
+    return species_names(ids);
+}
+
+/* answers the queries a chunk at a time, so that the bits marking which species each query has
+ * found stay within JOIN_WORDS words
  */
-list<string> TreeCollection::travereseSpecieZipcode(AvlNode<Tree> *t, int zipcode) const{
-    list<string> species_zipcode;
-    if (t != nullptr) {
-        travereseSpecieZipcode(t->left, zipcode);
-        if((t->element.zip_code()) == zipcode) {
-            for(auto &i : species_zipcode) {
-                if(hyphenLower(i) != hyphenLower(t->element.common_name())) {
-                    species_zipcode.push_back(hyphenLower(t->element.common_name()));
-                }
+void TreeCollection::get_all_near(const vector<NearQuery> & queries,
+                                  vector<vector<int> > & ids) const {
+    ids.resize(queries.size());
+    for(size_t q = 0; q < ids.size(); q++)
+        ids[q].clear();
+    size_t words = columns.species_dictionary().size() / 64 + 1;
+    size_t chunk = (words > JOIN_WORDS) ? 1 : JOIN_WORDS / words;
+    vector<uint64_t> found;
+    for(size_t first = 0; first < queries.size(); first += chunk) {
+        int count = std::min(chunk, queries.size() - first);
+        found.assign(count * words, 0);
+        by_position.join_near(&queries[first], count, [&](int q, int slot) {
+            int id = columns.species_dictionary().folded_id(columns.species_at(slot));
+            uint64_t & word = found[q * words + id / 64];
+            uint64_t mask = 1ULL << (id % 64);
+            if(!(word & mask)) {
+                word |= mask;
+                ids[first + q].push_back(id);
             }
-        }
-        travereseSpecieZipcode(t->right, zipcode);
+        });
     }
-    return species_zipcode;
 }
 
-/* helper for get_all_near
- * returns a list of all species within given zipcode based on GPS location
- */
-list<string> TreeCollection::traverseAllInZip(AvlNode<Tree> *t, double latitude, double longitude, double distance) const {
-    list<string> species_within;
-    double lat, lon;
-    double within_distance;
-
-    if (t != nullptr) {
-        traverseAllInZip(t->left, latitude, longitude, distance);
-        t->element.get_position(lat,lon);
-        within_distance = haversine(lat,lon,latitude,longitude);
-        if(within_distance <= distance) {
-            for(auto &i : species_within) {
-                if( i != t->element.common_name()) {
-                    species_within.push_back(i);
-                }
-            }
-        }
+vector<list<string> > TreeCollection::get_all_near(const vector<NearQuery> & queries) const {
+    vector<vector<int> > ids;
+    get_all_near(queries, ids);
+    vector<list<string> > common_within(queries.size());
+    for(size_t q = 0; q < queries.size(); q++)
+        common_within[q] = species_names(ids[q]);
+    return common_within;
+}
 
-        traverseAllInZip(t->right, latitude, longitude, distance);
+// returns a list of all species in the box, no duplicates
+list<string> TreeCollection::get_all_in_box(double south, double west,
+                                            double north, double east) const {
+    vector<int> ids;
+    by_position.in_box(south, west, north, east, found_slots);
+    columns.species_of(found_slots, ids);
+    return species_names(ids);
+}
+
+// returns a list of all species inside the polygon, no duplicates
+list<string> TreeCollection::get_all_in_polygon(const vector<GeoPoint> & polygon) const {
+    vector<int> ids;
+    by_position.in_polygon(polygon, found_slots);
+    columns.species_of(found_slots, ids);
+    return species_names(ids);
+}
+
+int TreeCollection::count_in_box(double south, double west, double north, double east) const {
+    int count = 0;
+    by_position.for_each_in_box(south, west, north, east, [&count](int, double, double) {
+        count++;
+    });
+    return count;
+}
+
+int TreeCollection::count_in_polygon(const vector<GeoPoint> & polygon) const {
+    int count = 0;
+    by_position.for_each_in_polygon(polygon, [&count](int, double, double) {
+        count++;
+    });
+    return count;
+}
+
+// turns species ids into a sorted list of their names
+list<string> TreeCollection::species_names(const vector<int> & ids) const {
+    vector<string> names;
+    names.reserve(ids.size());
+    for(size_t i = 0; i < ids.size(); i++)
+        names.push_back(string(species_name(ids[i])));
+    sort(names.begin(), names.end());
+    return list<string>(names.begin(), names.end());
+}
+
+// the version tree is built from the search tree the first time, and kept up to date after that
+PersistentAvlTree<Tree> TreeCollection::snapshot() const {
+    if(!versioned) {
+        vector<const Tree *> sorted;
+        sorted_trees(sorted);
+        versions.assign(sorted);
+        versioned = true;
     }
+    return versions;
+}
 
-    return species_within;
-}
\ No newline at end of file
+void TreeCollection::sorted_trees(vector<const Tree *> & sorted) const {
+    sorted.clear();
+    sorted.reserve(live_slots.cardinality());
+    for_each_tree([&sorted](const Tree & t) { sorted.push_back(&t); });
+}
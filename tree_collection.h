@@ -13,15 +13,40 @@ Modifications:
 #define TREE_COLLECTION_H
 #include "__tree_collection.h"
 #include "AvlTree.h"
+#include "BPlusTree.h"
+#include "EytzingerArray.h"
+#include "PersistentAvlTree.h"
 #include "tree_species.h"
+#include "tree_id_index.h"
+#include "tree_aggregate.h"
+#include "dbh_index.h"
+#include "slot_bitmap.h"
+#include "zorder_index.h"
+#include "species_ranking.h"
 #include "tree.h"
+#include <array>
+#include <map>
 #include <vector>
 #include <set>
 #include <stack>
+#include <unordered_map>
 
 
 using namespace std;
 
+class ChangeLog;
+
+/* The container that holds the trees is chosen at compile time: build with
+ * -DTREE_STORE_BPLUS to keep them in a BPlusTree, otherwise an AvlTree is used.
+ * Both offer insert, remove, find, findMin, findMax, for_each and their
+ * parallel forms.
+ */
+#ifdef TREE_STORE_BPLUS
+typedef BPlusTree<Tree> TreeStore;
+#else
+typedef AvlTree<Tree>   TreeStore;
+#endif
+
 class TreeCollection:public __TreeCollection, public AvlTree<Tree>{
     public:
         TreeCollection();
@@ -29,7 +54,8 @@ class TreeCollection:public __TreeCollection, public AvlTree<Tree>{
         ~TreeCollection();
 
 
-        /** total_tree_count() returns total number of trees in data set
+        /** total_tree_count() returns total number of trees in data set,
+         *                     those without a valid borough included
          *  @return int count of trees in collection  
          */
         int total_tree_count() override;
@@ -83,6 +109,9 @@ class TreeCollection:public __TreeCollection, public AvlTree<Tree>{
 
         /** add_tree(t) inserts Tree t into the collection, updates species list and
          *              borough counts.
+         * @note  tree_id is unique, so a tree whose id is already in the
+         *        collection is not inserted. With a log open, the tree is
+         *        not inserted either if its record cannot be written.
          * @param Tree new_tree [in] the tree to be inserted
          * @return int the number of trees inserted: 0 if none, 1 if inserted
          */
@@ -147,24 +176,447 @@ class TreeCollection:public __TreeCollection, public AvlTree<Tree>{
         list<string> get_all_near(double latitude, double longitude,
                              double  distance) const override;
 
+        /** snapshot() returns the collection as it is right now
+         * @notes
+         *       The snapshot shares every node with a version tree that
+         *       add_tree and remove_tree keep beside the search tree, and
+         *       later changes copy only the shared nodes on their own search
+         *       path. The snapshot is unaffected by them. The version tree
+         *       is built, in O(n), by the first call; until then no change
+         *       pays for it, and every later call is O(1).
+         * @return PersistentAvlTree<Tree> the trees in the collection
+         */
+        PersistentAvlTree<Tree> snapshot() const;
+
+        /** for_each_tree(f) calls f on every tree in sorted order
+         * @notes
+         *       This reads the search tree, or the read-only array while the
+         *       collection is frozen, in place; unlike snapshot() it keeps
+         *       nothing alive after it returns.
+         * @param Visit visit [in] called with each const Tree &
+         */
+        template <class Visit>
+        void for_each_tree(Visit visit) const {
+            if(frozen_mode)
+                frozen.for_each(visit);
+            else
+                collection.for_each(visit);
+        }
+
+        /** remove_tree(t) removes Tree t from the collection, updates species
+         *                 list and borough counts.
+         * @note  With a log open, the tree stays if its record cannot be written.
+         * @param Tree old_tree [in] the tree to be removed
+         * @return int the number of trees removed: 0 if none, 1 if removed
+         */
+        int remove_tree( const Tree & old_tree);
+
+        /** open_log(path,n) records every later add_tree and remove_tree in
+         *                   the change log at path
+         * @notes
+         *       Every n records (never, if n is 0) the collection is written
+         *       to path + ".snap" and the log is emptied. To recover after a
+         *       crash, call apply_log(path + ".snap") and then apply_log(path)
+         *       on an empty collection before calling open_log again.
+         * @param string log_path      [in] the change log file
+         * @param int    compact_every [in] records between compactions
+         * @return bool true if the log could be opened
+         */
+        bool open_log(const string & log_path, int compact_every = 0);
+
+        /** apply_log(path) replays a change log or snapshot into the collection
+         * @notes
+         *       Replaying the open log or its snapshot, as recovery does, is
+         *       not written to the log again; any other file is a set of
+         *       changes like any other, and is logged. A torn record at the
+         *       end of the file ends the replay.
+         * @param string log_path [in] the change log or snapshot file
+         * @return int the number of records applied, or -1 if path is not a log
+         */
+        int apply_log(const string & log_path);
+
+        /** compact_log() writes the collection to the snapshot file of the open
+         *                log and empties the log
+         * @return bool true if the snapshot was written and the log emptied
+         */
+        bool compact_log();
+
+        /** freeze() switches the collection to its read-only layout
+         * @notes
+         *       The trees are moved out of the search tree into a pointer-free
+         *       EytzingerArray, and find_tree and species range lookups use
+         *       it from then on. The next add_tree or remove_tree moves them
+         *       back into the search tree before changing anything.
+         */
+        void freeze();
+
+        /** is_frozen() returns true between freeze() and the next change */
+        bool is_frozen() const;
+
+        /** begin_bulk() starts a load: until end_bulk(), add_tree stages each
+         *               tree instead of placing it in the search tree
+         * @notes
+         *       The staged trees are sorted and merged into the search tree in
+         *       one linear pass by end_bulk() or by the first query or removal
+         *       that needs the search tree, whichever comes first. The id,
+         *       column and spatial indexes are kept up to date as usual.
+         */
+        void begin_bulk();
+
+        /** end_bulk() places the staged trees and ends the load */
+        void end_bulk();
+
+        /** merge(c) moves every tree of collection c into this one, leaving
+         *           c empty
+         * @notes
+         *       A tree of c whose tree_id is already here is dropped, as
+         *       add_tree would refuse it. The search trees are flattened,
+         *       merged and rebuilt in linear time rather than taking the
+         *       trees one insert at a time. Once snapshot() has been
+         *       called, the moved trees are merged into the version tree
+         *       the same way, and snapshots taken before are unaffected.
+         *       The moved trees are written to the open log, if any, with
+         *       one sync; if that fails nothing is moved.
+         * @param TreeCollection other [in,out] the collection to take the trees from
+         * @return int the number of trees moved, or -1 if the log write failed
+         */
+        int merge(TreeCollection && other);
+
+        /** extract_species(s) removes every tree of species s and returns them
+         * @notes
+         *       Names are compared as the trees are ordered, ignoring case.
+         *       The trees of a species are one key range, which is cut out
+         *       of the search trees with a split and a join in O(log n);
+         *       only freeing their slots takes time per tree.
+         * @param  string species_name [in] species name to remove
+         * @return vector<Tree> the removed trees, in order of tree_id
+         */
+        vector<Tree> extract_species(const string & species_name);
+
+        /** erase_range(lo,hi) removes every tree whose key (species, then
+         *                     tree_id) is at least lo's and less than hi's
+         * @param  Tree lo [in] the first key removed
+         * @param  Tree hi [in] the first key kept after the range
+         * @return int the number of trees removed
+         */
+        int erase_range(const Tree & lo, const Tree & hi);
+
+        /** find_tree(t) returns the tree in the collection with the same key
+         *               (species and id) as t
+         * @param Tree key [in] the tree to look for
+         * @return Tree the matching tree, or an empty tree if there is none
+         */
+        const Tree & find_tree( const Tree & key ) const;
+
+        /** get_tree_by_id(id) returns the tree with the given tree_id
+         * @notes
+         *       A hash lookup finds the tree's slot, which points at the
+         *       tree where the collection holds it, so this takes constant
+         *       time; only between begin_bulk and end_bulk is a tree added
+         *       since looked up by its key instead.
+         * @param int id [in] the tree_id to look for
+         * @return Tree the matching tree, or an empty tree if there is none
+         */
+        const Tree & get_tree_by_id( int id ) const;
+
+        /** remove_tree_by_id(id) removes the tree with the given tree_id
+         * @param int id [in] the tree_id of the tree to be removed
+         * @return int the number of trees removed: 0 if none, 1 if removed
+         */
+        int remove_tree_by_id( int id );
+
+        /** aggregate(g,f,m) counts the trees that pass filter f in groups
+         *                   formed by the columns g, with dbh metrics m
+         * @notes
+         *       For example, grouping by {GROUP_BOROUGH, GROUP_STATUS} gives
+         *       one row per borough and status. It is one pass over the
+         *       per-slot columns, not a traversal of the tree; see
+         *       TreeColumns::aggregate.
+         * @param vector<GroupColumn> group_by [in] the columns to group by
+         * @param TreeFilter          filter   [in] which trees to count
+         * @param int                 metrics  [in] the Metric values to compute
+         * @return vector<AggregateRow> one row per non-empty group, sorted
+         */
+        vector<AggregateRow> aggregate(const vector<GroupColumn> & group_by,
+                                       const TreeFilter & filter = TreeFilter(),
+                                       int metrics = METRIC_ALL) const;
+
+        /** count_in_dbh_range(lo,hi,b) returns the number of trees in boro b
+         *                              whose diameter is between lo and hi
+         * @notes
+         *       O(log n) in the number of distinct diameters. This method is
+         *       case insensitive; an empty boro_name counts every borough.
+         * @param int    lo        [in] the smallest diameter, inclusive
+         * @param int    hi        [in] the largest diameter, inclusive
+         * @param string boro_name [in] the borough to look in
+         * @return int the number of trees, 0 if boro_name is not a borough
+         */
+        int count_in_dbh_range(int lo, int hi, const string & boro_name = "") const;
+
+        /** get_all_in_dbh_range(lo,hi,b) returns the trees in boro b whose
+         *                                diameter is between lo and hi
+         * @notes
+         *       The trees come in order of increasing diameter. This method
+         *       is case insensitive; an empty boro_name means every borough.
+         * @param int    lo        [in] the smallest diameter, inclusive
+         * @param int    hi        [in] the largest diameter, inclusive
+         * @param string boro_name [in] the borough to look in
+         * @return vector<Tree> the trees, possibly none
+         */
+        vector<Tree> get_all_in_dbh_range(int lo, int hi,
+                                          const string & boro_name = "") const;
+
+        /** dbh_quantile(q,s) returns the diameter below which a fraction q of
+         *                    the trees of species s fall
+         * @notes
+         *       Nearest rank, so dbh_quantile(0.5, s) is the median diameter
+         *       of s and dbh_quantile(0.9, s) its 90th percentile. This
+         *       method is case insensitive; an empty species_name means every
+         *       tree.
+         * @param double q            [in] between 0 and 1
+         * @param string species_name [in] the species
+         * @return int the diameter, or -1 if there are no trees of species s
+         */
+        int dbh_quantile(double q, const string & species_name = "") const;
+
+        /** top_species(n,b) returns the n species with the most trees in boro b
+         * @notes
+         *       The counts are kept in order by add_tree and remove_tree, so
+         *       this is O(n) whatever the size of the collection. Species
+         *       with the same count come in no set order. This method is
+         *       case insensitive; an empty boro_name means the whole city.
+         * @param int    n         [in] how many species
+         * @param string boro_name [in] the borough to look in
+         * @return vector<pair<string,int>> (name, count) pairs, most trees
+         *         first; empty if boro_name is not a borough
+         */
+        vector<pair<string, int> > top_species(int n, const string & boro_name = "") const;
+
+        /** top_species_in_zipcode(n,z) returns the n species with the most
+         *                             trees in zipcode z, as top_species does
+         */
+        vector<pair<string, int> > top_species_in_zipcode(int n, int zipcode) const;
+
+        /** slots_with(v) returns the set of slots holding trees with status,
+         *               health or borough v
+         * @notes
+         *       Combine the sets with &, | and SlotBitmap::and_not, then pass
+         *       the result to get_trees or take its cardinality(). For
+         *       example, dead or stump trees in Brooklyn that are not in good
+         *       health:
+         *       (slots_with(STATUS_DEAD) | slots_with(STATUS_STUMP))
+         *           .and_not(slots_with(HEALTH_GOOD)) & slots_with(BROOKLYN)
+         *       Trees whose status or health is not valid are counted as
+         *       STATUS_NONE or HEALTH_NONE, as aggregate does.
+         * @param Status, Health or Borough v [in] the value
+         * @return SlotBitmap the slots, empty if v is a count such as BOROUGHS
+         */
+        const SlotBitmap & slots_with(Status status) const;
+        const SlotBitmap & slots_with(Health health) const;
+        const SlotBitmap & slots_with(Borough borough) const;
+
+        /** all_slots() returns the slots of every tree in the collection */
+        const SlotBitmap & all_slots() const;
+
+        /** slots_matching(f) returns the slots of the trees that pass filter f
+         * @notes
+         *       The borough, status and health of f are intersected as
+         *       bitmaps first; only the trees left are checked against the
+         *       species, zipcode and diameter of f, which are read from the
+         *       columns, as aggregate reads them.
+         * @param TreeFilter filter [in] the conditions, all of which must hold
+         * @return SlotBitmap the slots
+         */
+        SlotBitmap slots_matching(const TreeFilter & filter) const;
+
+        /** get_trees(s) returns the trees stored in the slots of s
+         * @param SlotBitmap s [in] slots from slots_with or slots_matching
+         * @return vector<Tree> the trees, in slot order
+         */
+        vector<Tree> get_trees(const SlotBitmap & s) const;
+
+        /* The queries below answer get_matching_species, get_all_in_zipcode
+         * and get_all_near without building a list<string>. They write
+         * species ids into a vector the caller keeps and reuses, and
+         * species_name(id) turns an id into a view of the stored name. Once
+         * the vector has grown to fit, a query loop does not allocate. The
+         * scratch space they use is kept per thread, so several threads may
+         * query one collection at once.
+         */
+
+        /** species_id(s) returns the id of species s, case insensitively
+         * @param string_view species_name [in] the name
+         * @return int the id, or -1 if no tree has ever had that name
+         */
+        int species_id(string_view species_name) const;
+
+        /** species_name(id) returns the common name with the given id
+         * @notes The view stays valid for the life of the collection.
+         * @param int id [in] an id from species_id or the queries below
+         * @return string_view the name
+         */
+        string_view species_name(int id) const;
+
+        /** get_matching_species(s,ids) puts the ids of all species names that
+         *                              contain s into ids
+         * @param string_view species_name [in]  the partial name to match
+         * @param vector<int> ids          [out] the ids, no duplicates
+         */
+        void get_matching_species(string_view species_name, vector<int> & ids) const;
+
+        /** get_all_in_zipcode(z,ids) puts the ids of all species in zipcode z
+         *                           into ids
+         * @param int         zipcode [in]  the zipcode in which to search
+         * @param vector<int> ids     [out] the ids, no duplicates
+         */
+        void get_all_in_zipcode(int zipcode, vector<int> & ids) const;
+
+        /** get_all_near(lat,lng,dist,ids) puts the ids of all species within
+         *                                dist km of (lat,lng) into ids
+         * @param double      latitude  [in]  the latitude
+         * @param double      longitude [in]  the longitude
+         * @param double      distance  [in]  the distance in kilometers
+         * @param vector<int> ids       [out] the ids, no duplicates
+         */
+        void get_all_near(double latitude, double longitude, double distance,
+                          vector<int> & ids) const;
+
+        /** count_species_near(lat,lng,dist,e) returns the number of distinct
+         *                                     species within dist km of
+         *                                     (lat,lng)
+         * @notes
+         *       Equal to the size of get_all_near(lat,lng,dist), without
+         *       building it. The count is exact while the collection has
+         *       seen at most TreeColumns::EXACT_SPECIES species names; past
+         *       that it is a HyperLogLog estimate if estimate is true.
+         * @param double latitude  [in] the latitude
+         * @param double longitude [in] the longitude
+         * @param double distance  [in] the distance in kilometers
+         * @param bool   estimate  [in] false to always count exactly
+         * @return int the number of species
+         */
+        int count_species_near(double latitude, double longitude, double distance,
+                               bool estimate = true) const;
+
+        /** get_all_near(q,ids) answers a batch of get_all_near queries at once,
+         *                     putting the ids of the species within
+         *                     q[i].distance km of (q[i].latitude,q[i].longitude)
+         *                     into ids[i]
+         * @notes
+         *       The trees are read once for the whole batch, not once per
+         *       query; see ZOrderIndex::join_near. A query with a negative
+         *       distance finds nothing.
+         * @param vector<NearQuery>   queries [in]  the circles
+         * @param vector<vector<int>> ids     [out] one list of ids per query,
+         *                                          no duplicates
+         */
+        void get_all_near(const vector<NearQuery> & queries,
+                          vector<vector<int> > & ids) const;
+
+        /** get_all_near(q) returns, for each query in q, the list<string> that
+         *                 get_all_near(lat,lng,dist) would return for it
+         * @param vector<NearQuery> queries [in] the circles
+         * @return vector<list<string>> the species names, one list per query
+         */
+        vector<list<string> > get_all_near(const vector<NearQuery> & queries) const;
+
+        /** get_all_in_box(s,w,n,e) returns a list<string> containing all tree
+         *                         species with s <= latitude <= n and
+         *                         w <= longitude <= e
+         * @notes
+         *       The list is sorted and has no duplicate names. Only the trees
+         *       in cells along the edges of the box are compared with it.
+         * @param double south [in] the smallest latitude
+         * @param double west  [in] the smallest longitude
+         * @param double north [in] the largest latitude
+         * @param double east  [in] the largest longitude
+         * @return list<string> the species names, empty if south > north or
+         *                      west > east
+         */
+        list<string> get_all_in_box(double south, double west,
+                                    double north, double east) const;
+
+        /** get_all_in_polygon(p) returns a list<string> containing all tree
+         *                       species inside polygon p
+         * @notes
+         *       The list is sorted and has no duplicate names. The corners of
+         *       p are given in order and the last joins back to the first; a
+         *       park or a community district boundary, for example. Only the
+         *       trees in cells that an edge of p passes through are tested
+         *       against p.
+         * @param vector<GeoPoint> polygon [in] at least three corners
+         * @return list<string> the species names
+         */
+        list<string> get_all_in_polygon(const vector<GeoPoint> & polygon) const;
+
+        /** count_in_box(s,w,n,e) returns the number of trees in the box
+         *                       that get_all_in_box(s,w,n,e) looks in
+         */
+        int count_in_box(double south, double west, double north, double east) const;
+
+        /** count_in_polygon(p) returns the number of trees inside polygon p */
+        int count_in_polygon(const vector<GeoPoint> & polygon) const;
+
     private:
 
         AvlNode<Tree> *root;
-        AvlTree<Tree> collection;
-        set<string> list_of_species;     // stores the set of all common names
-
-        list<string> traverseSpecies(AvlNode<Tree> *t, const string &species);  //helper to traverse tree and find matching species
-        set<string> traverseAll(AvlNode<Tree> *t) const; //helper to traverse whole tree
-        list<string> traverseMatch(AvlNode<Tree> *t, const string &species) const;  //helper to traverse tree to find partial matches
-        int traverseBoro(AvlNode<Tree> *t, const string&species);  //helper to traverses tree to find boro
-        int traverseSpeciesBoro(AvlNode<Tree> *t, const string&species, const string&boro); // helper to traverse tree to find number of species in given boro
-        boro traverseSpeciesByBoro(AvlNode<Tree> *t, const string&species); // helper to traverse tree to find number of species in each boro and aggregate them
-        list<string> travereseSpecieZipcode(AvlNode<Tree> *t, int zipcode) const; //helper to traverse tree to find all species within given zipcode
-        list<string> traverseAllInZip(AvlNode<Tree> *t, double latitude, double longitude, double distance) const ;    // helper function to return list of all common species located within given distance from GPS position
+        TreeStore collection;
+        EytzingerArray<Tree> frozen;       // holds the trees instead of collection while frozen_mode
+        bool frozen_mode;
+        bool bulk_mode;                    // true between begin_bulk and end_bulk
+        mutable PersistentAvlTree<Tree> versions;  // same trees as collection, shared with snapshots,
+        mutable bool versioned;                    // once snapshot() has built it
+        ChangeLog *change_log;             // log opened by open_log, or nullptr
+        string snapshot_path;              // where compact_log writes the collection
+        int compact_every;                 // records between compactions, 0 for never
+        bool replaying;                    // true while apply_log replays the open log or its snapshot
+        map<string, int> list_of_species;  // every common name, and how many trees have it
+        vector<int> slot_ids;              // tree_id by slot; with the species in columns, the tree's key
+        vector<const Tree *> slot_trees;   // the tree at each slot, where collection or frozen holds it;
+                                           // nullptr while it is staged by begin_bulk
+        vector<int> free_slots;            // slots freed by remove_tree, reused first
+        TreeIdIndex by_id;                 // tree_id -> slot
+        TreeColumns columns;               // the fields reports use, by slot
+        DbhIndex by_dbh;                   // slots ordered by diameter
+        ZOrderIndex by_position;           // slots ordered along a Z-order curve of their position
+        SlotBitmap live_slots;             // every slot that holds a tree
+        SlotBitmap status_slots[STATUSES]; // slots by status, by health and by borough
+        SlotBitmap health_slots[HEALTHS];
+        SlotBitmap borough_slots[BOROUGHS];
+        void index_slot(int slot, const Tree & t, bool present);  // adds or removes slot in the bitmaps
+        SpeciesRanking city_ranking;                      // species by trees, in the city,
+        SpeciesRanking borough_ranking[BOROUGHS];         // in each borough
+        unordered_map<int, SpeciesRanking> zipcode_ranking;   // and in each zipcode
+        void rank_slot(int slot, const Tree & t, bool present);   // counts the tree at slot in or out of them
+        vector<pair<string, int> > top_of(const SpeciesRanking & ranking, int n) const;
+
+        bool log_change(int op, const Tree & t);   // logs a ChangeLog::Operation; false if that failed
+        void thaw();   // moves the trees back from frozen into collection
+        void sorted_trees(vector<const Tree *> & sorted) const;   // every tree, in order
+        int  store_slot(const Tree & t, const Tree * stored);  // puts t, held at stored, in a slot and the per-slot indexes
+        void release_slot(int slot, const Tree & t);   // takes t, the tree at slot, out of them again
+        Tree slot_key(int slot) const;     // the key of the tree at slot
+        const Tree & tree_at(int slot) const;   // the tree at slot
+        void point_slots();                // points slot_trees at the trees where they now are
+        int  take_range(const Tree & lo, const Tree & hi, vector<Tree> * taken);
+        void clear_trees();                // empties every structure that holds trees
+        list<string> species_names(const vector<int> & ids) const;  // the names of ids, sorted
+
+        /* folds map(t) of every tree into identity with combine; the tree is cut into
+         * subtrees folded on the threads of the shared pool, unless frozen
+         */
+        template <class T, class Map, class Combine>
+        T reduce_trees(const T & identity, Map map, Combine combine) const {
+            if(!frozen_mode)
+                return collection.parallel_reduce(identity, map, combine);
+            T result = identity;
+            frozen.for_each([&](const Tree & t) { result = combine(result, map(t)); });
+            return result;
+        }
 
         int tree_count;
-        boro boroughs[5];          // stores the names of each NYC borough and how many trees from the data set are in each borough
-    //borough[0] = Manhattan, borough[1] = Bronx, borough[2] = Brooklyn, borough[3] = Queens, borough[4] = Staten Island
+        boro boroughs[BOROUGHS];   // stores the names of each NYC borough and how many trees from the data set are in each borough
+    //indexed by Borough: borough[0] = Manhattan, borough[1] = Bronx, borough[2] = Brooklyn, borough[3] = Queens, borough[4] = Staten Island
 };
 
 
@@ -0,0 +1,96 @@
+/******************************************************************************
+Title : tree_id_index.cpp
+Author : Yu Tong Chen
+Created on : 04/25/2019
+Description : The implementation of tree_id_index.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "tree_id_index.h"
+
+// default constructor, starting with 16 empty entries
+TreeIdIndex::TreeIdIndex():live(0), used(0) {
+    rehash(16);
+}
+
+/* probes from the home position, reusing the first tombstone it passes
+ * a full table doubles if it is mostly live entries, otherwise it is only swept of tombstones
+ */
+bool TreeIdIndex::insert(int id, int slot) {
+    if ((size_t)(used + 1) * 10 > table.size() * 7)
+        rehash((size_t)(live + 1) * 2 > table.size() ? table.size() * 2 : table.size());
+
+    size_t mask = table.size() - 1;
+    size_t reuse = table.size();
+    for (size_t i = home(id); ; i = (i + 1) & mask) {
+        if (table[i].id == id)
+            return false;
+        if (table[i].id == ERASED && reuse == table.size())
+            reuse = i;
+        if (table[i].id == EMPTY) {
+            if (reuse == table.size()) {
+                reuse = i;
+                used++;
+            }
+            table[reuse].id = id;
+            table[reuse].slot = slot;
+            live++;
+            return true;
+        }
+    }
+}
+
+int TreeIdIndex::find(int id) const {
+    size_t mask = table.size() - 1;
+    for (size_t i = home(id); table[i].id != EMPTY; i = (i + 1) & mask) {
+        if (table[i].id == id)
+            return table[i].slot;
+    }
+    return -1;
+}
+
+bool TreeIdIndex::erase(int id) {
+    size_t mask = table.size() - 1;
+    for (size_t i = home(id); table[i].id != EMPTY; i = (i + 1) & mask) {
+        if (table[i].id == id) {
+            table[i].id = ERASED;
+            live--;
+            return true;
+        }
+    }
+    return false;
+}
+
+int TreeIdIndex::size() const {
+    return live;
+}
+
+void TreeIdIndex::clear() {
+    table.clear();      // rehash would otherwise carry the old entries over
+    rehash(16);
+}
+
+// Fibonacci hashing: the top bits of id * 2^32/phi spread consecutive ids apart
+unsigned int TreeIdIndex::home(int id) const {
+    return ((unsigned int)id * 2654435769u) >> shift;
+}
+
+// moves every live entry into a fresh table of the given power-of-two capacity, dropping tombstones
+void TreeIdIndex::rehash(size_t capacity) {
+    vector<Entry> old;
+    old.swap(table);
+    Entry empty = {EMPTY, 0};
+    table.assign(capacity, empty);
+    shift = 32;
+    for (size_t c = capacity; c > 1; c >>= 1)
+        shift--;
+    live = 0;
+    used = 0;
+    for (size_t i = 0; i < old.size(); i++) {
+        if (old[i].id >= 0)
+            insert(old[i].id, old[i].slot);
+    }
+}
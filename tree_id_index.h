@@ -0,0 +1,64 @@
+/******************************************************************************
+Title : tree_id_index.h
+Author : Yu Tong Chen
+Created on : 04/25/2019
+Description : The interface of TreeIdIndex, an open-addressing hash table
+              from tree_id to the slot that holds the tree.
+Usage : Maintained by TreeCollection::add_tree and remove_tree.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef TREE_ID_INDEX_H
+#define TREE_ID_INDEX_H
+#include <vector>
+
+
+using namespace std;
+
+/** class TreeIdIndex
+ *  Entries live directly in one power-of-two array and collisions probe
+ *  linearly, so a lookup is a multiply, a shift and usually a single cache
+ *  line. Erased entries leave a tombstone that later inserts reuse; the
+ *  table is rebuilt when live entries plus tombstones pass 70% of capacity.
+ */
+class TreeIdIndex {
+    public:
+        TreeIdIndex();
+
+        /** insert(id,slot) maps id to slot
+         * @param int id   [in] the tree_id, which must not be negative
+         * @param int slot [in] where the tree is stored
+         * @return bool true if id was added, false if it was already present
+         */
+        bool insert(int id, int slot);
+
+        /** find(id) returns the slot of id, or -1 if it is not present */
+        int find(int id) const;
+
+        /** erase(id) removes id; returns false if it was not present */
+        bool erase(int id);
+
+        int  size() const;
+        void clear();
+
+    private:
+        struct Entry {
+            int id;       // EMPTY, ERASED or a tree_id
+            int slot;
+        };
+        static const int EMPTY  = -1;
+        static const int ERASED = -2;
+
+        vector<Entry> table;
+        int           shift;      // 32 - log2(table.size())
+        int           live;
+        int           used;       // live entries plus tombstones
+
+        unsigned int home(int id) const;
+        void rehash(size_t capacity);
+};
+
+
+#endif //TREE_ID_INDEX_H
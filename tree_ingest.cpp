@@ -0,0 +1,163 @@
+/******************************************************************************
+Title : tree_ingest.cpp
+Author : Yu Tong Chen
+Created on : 04/12/2019
+Description : The implementation of tree_ingest.
+Usage :
+Build with : Makefile (needs -pthread)
+Modifications:
+
+******************************************************************************/
+
+#include "tree_ingest.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+// constructor
+TreeIngest::TreeIngest(size_t buffer_bytes, size_t batch_rows)
+    :ring(buffer_bytes > 0 ? buffer_bytes : 1), head(0), count(0), eof(false), read_error(0),
+     batch_rows(batch_rows > 0 ? batch_rows : 1), rows(0), too_long(0) {
+}
+
+// streams path through the ring buffer into collection, one batch of rows at a time
+long TreeIngest::load(const string & path, __TreeCollection & collection, bool skip_header) {
+    int fd = (path == "-") ? 0 : open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    head = 0;
+    count = 0;
+    eof = false;
+    read_error = 0;
+    rows = 0;
+    too_long = 0;
+    batch.resize(batch_rows);
+
+    thread reader(&TreeIngest::produce, this, fd);
+
+    long added = 0;
+    size_t n = 0;
+    string row;
+    if (skip_header)
+        next_row(row);
+    while (next_row(row)) {
+        rows++;
+        batch[n].swap(row);     // keeps both strings' capacity for reuse
+        if (++n == batch_rows) {
+            added += flush_batch(n, collection);
+            n = 0;
+        }
+    }
+    added += flush_batch(n, collection);
+
+    reader.join();
+    if (fd != 0)
+        close(fd);
+    return read_error != 0 ? -1 : added;
+}
+
+long TreeIngest::rows_read() const {
+    return rows;
+}
+
+long TreeIngest::rows_too_long() const {
+    return too_long;
+}
+
+int TreeIngest::error() const {
+    return read_error;
+}
+
+/* reads straight into the free part of the ring, waiting while it is full
+ * the read itself runs unlocked: the consumer never touches bytes outside [head, head+count);
+ * an interrupted read is retried, and any other failure ends the input like end of file does
+ */
+void TreeIngest::produce(int fd) {
+    size_t capacity = ring.size();
+    while (true) {
+        size_t tail, room;
+        {
+            unique_lock<mutex> guard(lock);
+            not_full.wait(guard, [&] { return count < capacity; });
+            if (count == 0)
+                head = 0;           // empty ring: restart at the front for the longest read
+            tail = (head + count) % capacity;
+            room = (tail >= head) ? capacity - tail : head - tail;
+        }
+        ssize_t got;
+        do
+            got = read(fd, &ring[tail], room);
+        while (got < 0 && errno == EINTR);
+        unique_lock<mutex> guard(lock);
+        if (got <= 0) {
+            if (got < 0)
+                read_error = errno;
+            eof = true;
+            not_empty.notify_one();
+            return;
+        }
+        count += got;
+        not_empty.notify_one();
+    }
+}
+
+/* cuts the next complete row out of the ring into row, without its line ending
+ * a row longer than the ring is dropped; returns false once the input is exhausted
+ */
+bool TreeIngest::next_row(string & row) {
+    size_t capacity = ring.size();
+    size_t scanned = 0;         // bytes already searched for a newline
+    bool dropping = false;      // inside a row that did not fit
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        for (; scanned < count; scanned++) {
+            if (ring[(head + scanned) % capacity] == '\n')
+                break;
+        }
+        if (scanned < count || (eof && count > 0)) {
+            size_t len = scanned;
+            if (!dropping) {
+                row.clear();
+                size_t first = min(len, capacity - head);
+                row.append(&ring[head], first);
+                row.append(&ring[0], len - first);
+                if (!row.empty() && row[row.size() - 1] == '\r')
+                    row.erase(row.size() - 1);
+            }
+            size_t used = min(len + 1, count);
+            head = (head + used) % capacity;
+            count -= used;
+            not_full.notify_one();
+            if (!dropping)
+                return true;
+            dropping = false;
+            scanned = 0;
+            continue;
+        }
+        if (eof)
+            return false;
+        if (count == capacity) {    // no newline in a full ring: drop the row
+            if (!dropping)
+                too_long++;
+            dropping = true;
+            head = 0;
+            count = 0;
+            scanned = 0;
+            not_full.notify_one();
+        }
+        not_empty.wait(guard);
+    }
+}
+
+// parses the first n rows of the batch, adding the valid trees to collection
+long TreeIngest::flush_batch(size_t n, __TreeCollection & collection) {
+    long added = 0;
+    for (size_t i = 0; i < n; i++) {
+        Tree tree(batch[i]);
+        if (tree.id() != 0)         // the parser returns an empty tree for invalid rows
+            added += collection.add_tree(tree);
+    }
+    return added;
+}
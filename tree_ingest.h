@@ -0,0 +1,88 @@
+/******************************************************************************
+Title : tree_ingest.h
+Author : Yu Tong Chen
+Created on : 04/12/2019
+Description : The interface of TreeIngest, which streams census CSV rows
+              from a file or a pipe into a collection in bounded memory.
+Usage : TreeIngest ingest; ingest.load("-", collection);  // reads stdin
+Build with : Makefile (needs -pthread)
+Modifications:
+
+******************************************************************************/
+
+#ifndef TREE_INGEST_H
+#define TREE_INGEST_H
+#include "tree_collection.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+/** class TreeIngest
+ *  A reader thread copies raw bytes from the input into a fixed-size ring
+ *  buffer and blocks while the ring is full, so a fast producer such as
+ *  zcat is throttled to the parsing speed. The calling thread cuts complete
+ *  rows out of the ring, including rows split across reads or across the
+ *  end of the ring, parses them a batch at a time and adds the valid ones
+ *  to the collection. Memory used is the ring plus one batch of rows, no
+ *  matter how large the input is.
+ */
+class TreeIngest {
+    public:
+        /** TreeIngest(bytes,rows) sets the ring and batch sizes
+         * @param size_t buffer_bytes [in] capacity of the ring buffer; also
+         *                                 the longest row that can be read
+         * @param size_t batch_rows   [in] rows parsed per batch
+         */
+        TreeIngest(size_t buffer_bytes = 1 << 20, size_t batch_rows = 1024);
+
+        /** load(path,collection) adds every valid row of path to collection
+         * @param string path [in] the csv file, or "-" for standard input;
+         *                         it does not need to be seekable
+         * @param __TreeCollection collection [in,out] receives the trees
+         * @param bool skip_header [in] true if the first row names the columns
+         * @return long the number of trees added, or -1 if path can't be
+         *              opened or a read from it failed; the trees of the
+         *              rows read before the failure are still added
+         */
+        long load(const string & path, __TreeCollection & collection,
+                  bool skip_header = true);
+
+        /** rows_read() returns the rows seen by the last load, valid or not */
+        long rows_read() const;
+
+        /** rows_too_long() returns the rows of the last load that were
+         *                  dropped for not fitting in the ring buffer
+         */
+        long rows_too_long() const;
+
+        /** error() returns the errno of the read that failed in the last
+         *          load, or 0 if the input was read to its end
+         */
+        int error() const;
+
+    private:
+        vector<char>       ring;
+        size_t             head;          // next byte to consume
+        size_t             count;         // bytes in the ring
+        bool               eof;           // reader thread reached end of input
+        int                read_error;    // errno of the read that ended it, or 0
+        mutex              lock;
+        condition_variable not_full;
+        condition_variable not_empty;
+
+        size_t             batch_rows;
+        vector<string>     batch;         // rows reused from batch to batch
+        long               rows;
+        long               too_long;
+
+        void produce(int fd);                           // reader thread body
+        bool next_row(string & row);                    // cut one row out of the ring
+        long flush_batch(size_t n, __TreeCollection & collection);
+};
+
+
+#endif //TREE_INGEST_H
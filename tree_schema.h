@@ -0,0 +1,278 @@
+/******************************************************************************
+Title : tree_schema.h
+Author : Yu Tong Chen
+Created on : 04/15/2019
+Description : The column layouts of the census files and the csv parser
+              that is generated from them at compile time.
+Usage : parse_tree_row<Census2015>(line, row), or through Tree::from_csv.
+        To read another census year, add a struct like Census2015 whose
+        columns table lists that year's positions.
+Build with : No building (header only, needs C++17)
+Modifications:
+
+******************************************************************************/
+
+#ifndef TREE_SCHEMA_H
+#define TREE_SCHEMA_H
+
+#include <cctype>
+#include <cstdlib>
+#include <string_view>
+
+
+/** The ten fields a Tree keeps. Each parsed value lands in the slot of its
+ *  field, so the parser never needs to branch on which field it is filling.
+ */
+enum TreeField { FIELD_ID, FIELD_DBH, FIELD_STATUS, FIELD_HEALTH, FIELD_SPECIES,
+                 FIELD_ADDRESS, FIELD_ZIPCODE, FIELD_BOROUGH, FIELD_LATITUDE,
+                 FIELD_LONGITUDE, TREE_FIELDS };
+
+/** The five boroughs, numbered as the boroughs[5] arrays of the collections
+ *  are. BOROUGHS, the count, is also what a tree without a valid borough holds.
+ */
+enum Borough { MANHATTAN, BRONX, BROOKLYN, QUEENS, STATEN_ISLAND, BOROUGHS };
+
+inline constexpr const char *BOROUGH_NAMES[BOROUGHS] = {
+    "Manhattan", "Bronx", "Brooklyn", "Queens", "Staten Island"
+};
+
+/** borough_of(s) classifies a borough name exactly as the census spells it
+ *  @note  No two names have the same length, so this is one switch and at
+ *         most one compare.
+ *  @param string_view s [in] the name
+ *  @return Borough the borough, or BOROUGHS if s is not one
+ */
+inline Borough borough_of(std::string_view s) {
+    switch (s.size()) {
+        case 5:  return s == "Bronx"         ? BRONX         : BOROUGHS;
+        case 6:  return s == "Queens"        ? QUEENS        : BOROUGHS;
+        case 8:  return s == "Brooklyn"      ? BROOKLYN      : BOROUGHS;
+        case 9:  return s == "Manhattan"     ? MANHATTAN     : BOROUGHS;
+        case 13: return s == "Staten Island" ? STATEN_ISLAND : BOROUGHS;
+        default: return BOROUGHS;
+    }
+}
+
+/** borough_named(s) classifies a borough name typed by a user
+ *  @note  Case is ignored and '-' reads as ' ', as in the species queries.
+ *  @param string_view s [in] the name
+ *  @return Borough the borough, or BOROUGHS if s is not one
+ */
+inline Borough borough_named(std::string_view s) {
+    char buf[16];
+    if (s.size() >= sizeof(buf))
+        return BOROUGHS;
+    for (size_t i = 0; i < s.size(); i++) {   // rewrite s the way the census spells it
+        bool word_start = (i == 0 || buf[i - 1] == ' ');
+        unsigned char c = s[i];
+        buf[i] = (c == '-') ? ' ' : word_start ? toupper(c) : tolower(c);
+    }
+    return borough_of(std::string_view(buf, s.size()));
+}
+
+/** The values of status and health, the empty string included. STATUSES
+ *  and HEALTHS, the counts, also stand for a value that is not valid.
+ */
+enum Status { STATUS_NONE, STATUS_ALIVE, STATUS_DEAD, STATUS_STUMP, STATUSES };
+enum Health { HEALTH_NONE, HEALTH_GOOD, HEALTH_FAIR, HEALTH_POOR, HEALTHS };
+
+inline constexpr const char *STATUS_NAMES[STATUSES] = { "", "Alive", "Dead", "Stump" };
+inline constexpr const char *HEALTH_NAMES[HEALTHS]  = { "", "Good", "Fair", "Poor" };
+
+// classify status and health the way borough_of does, switching on the length first
+inline Status status_of(std::string_view s) {
+    switch (s.size()) {
+        case 0:  return STATUS_NONE;
+        case 4:  return s == "Dead" ? STATUS_DEAD : STATUSES;
+        case 5:  return s == "Alive" ? STATUS_ALIVE : s == "Stump" ? STATUS_STUMP : STATUSES;
+        default: return STATUSES;
+    }
+}
+
+inline Health health_of(std::string_view s) {
+    switch (s.size()) {
+        case 0:  return HEALTH_NONE;
+        case 4:  return s == "Good" ? HEALTH_GOOD : s == "Fair" ? HEALTH_FAIR
+                      : s == "Poor" ? HEALTH_POOR : HEALTHS;
+        default: return HEALTHS;
+    }
+}
+
+enum ColumnType { COLUMN_INT, COLUMN_TEXT, COLUMN_DECIMAL };
+
+/** The validators from the Data Dictionary in tree.h */
+enum ColumnCheck {
+    CHECK_NON_NEGATIVE,   // digits only
+    CHECK_ZIPCODE,        // one to five digits
+    CHECK_STATUS,         // "Alive", "Dead", "Stump" or empty
+    CHECK_HEALTH,         // "Good", "Fair", "Poor" or empty
+    CHECK_NAME,           // possibly empty, but not a number
+    CHECK_NOT_EMPTY,      // any non-empty text
+    CHECK_BOROUGH,        // one of the five borough names
+    CHECK_DECIMAL         // a decimal number
+};
+
+struct Column {
+    int         index;    // 0-based position in the csv row
+    TreeField   field;
+    ColumnType  type;
+    ColumnCheck check;
+};
+
+/** Census2015 is the layout of the 2015 Street Tree Census, 41 columns.
+ *  Its columns must be listed in increasing order of index.
+ */
+struct Census2015 {
+    static constexpr int field_count = 41;
+    static constexpr Column columns[] = {
+        {  0, FIELD_ID,        COLUMN_INT,     CHECK_NON_NEGATIVE },
+        {  3, FIELD_DBH,       COLUMN_INT,     CHECK_NON_NEGATIVE },
+        {  6, FIELD_STATUS,    COLUMN_TEXT,    CHECK_STATUS       },
+        {  7, FIELD_HEALTH,    COLUMN_TEXT,    CHECK_HEALTH       },
+        {  9, FIELD_SPECIES,   COLUMN_TEXT,    CHECK_NAME         },
+        { 24, FIELD_ADDRESS,   COLUMN_TEXT,    CHECK_NOT_EMPTY    },
+        { 25, FIELD_ZIPCODE,   COLUMN_INT,     CHECK_ZIPCODE      },
+        { 29, FIELD_BOROUGH,   COLUMN_TEXT,    CHECK_BOROUGH      },
+        { 37, FIELD_LATITUDE,  COLUMN_DECIMAL, CHECK_DECIMAL      },
+        { 38, FIELD_LONGITUDE, COLUMN_DECIMAL, CHECK_DECIMAL      },
+    };
+};
+
+/** TreeRow holds the fields of one parsed row. The text views point into
+ *  the row that was parsed and are only valid while it is. The borough is
+ *  in both text and number, the latter as a Borough.
+ */
+struct TreeRow {
+    std::string_view text[TREE_FIELDS];
+    int              number[TREE_FIELDS];
+    double           decimal[TREE_FIELDS];
+};
+
+
+namespace tree_schema {
+
+// helper to check that s is non-empty and all digits
+inline bool all_digits(std::string_view s) {
+    if (s.empty())
+        return false;
+    for (char c : s)
+        if (c < '0' || c > '9')
+            return false;
+    return true;
+}
+
+/* helper to read the field starting at p and move p past its comma; quoted fields may hold commas
+ * p becomes null after the last field of the row
+ */
+inline bool next_field(const char * & p, const char * end, std::string_view & field) {
+    if (p == nullptr)
+        return false;
+    if (p < end && *p == '"') {
+        const char *start = ++p;
+        while (p < end && *p != '"')
+            p++;
+        field = std::string_view(start, p - start);
+        while (p < end && *p != ',')
+            p++;
+    }
+    else {
+        const char *start = p;
+        while (p < end && *p != ',')
+            p++;
+        field = std::string_view(start, p - start);
+    }
+    p = (p < end) ? p + 1 : nullptr;
+    return true;
+}
+
+// helper to skip n fields without looking at their contents
+inline bool skip_fields(const char * & p, const char * end, int n) {
+    std::string_view ignored;
+    for (int i = 0; i < n; i++)
+        if (!next_field(p, end, ignored))
+            return false;
+    return true;
+}
+
+/* parses columns K, K+1, ... of Schema, p being at the field just after column K-1
+ * the gap to skip, the slot to fill and the validator are all fixed when the template is instantiated
+ */
+template <class Schema, size_t K = 0>
+inline bool parse_columns(const char * & p, const char * end, TreeRow & row) {
+    constexpr size_t count = sizeof(Schema::columns) / sizeof(Column);
+    if constexpr (K == count) {
+        return true;
+    }
+    else {
+        constexpr Column col = Schema::columns[K];
+        constexpr int    gap = col.index - (K == 0 ? 0 : Schema::columns[K - 1].index + 1);
+        static_assert(gap >= 0, "schema columns must be in increasing order");
+        static_assert(col.index < Schema::field_count, "schema column past the end of the row");
+
+        std::string_view text;
+        if (!skip_fields(p, end, gap) || !next_field(p, end, text))
+            return false;
+
+        if constexpr (col.check == CHECK_NON_NEGATIVE) {
+            if (!all_digits(text) || text.size() > 9) return false;
+        }
+        else if constexpr (col.check == CHECK_ZIPCODE) {
+            if (!all_digits(text) || text.size() > 5) return false;
+        }
+        else if constexpr (col.check == CHECK_STATUS) {
+            if (status_of(text) == STATUSES) return false;
+        }
+        else if constexpr (col.check == CHECK_HEALTH) {
+            if (health_of(text) == HEALTHS) return false;
+        }
+        else if constexpr (col.check == CHECK_NAME) {
+            if (all_digits(text)) return false;
+        }
+        else if constexpr (col.check == CHECK_NOT_EMPTY) {
+            if (text.empty()) return false;
+        }
+        else if constexpr (col.check == CHECK_BOROUGH) {   // classified here, once
+            row.number[col.field] = borough_of(text);
+            if (row.number[col.field] == BOROUGHS) return false;
+        }
+
+        if constexpr (col.type == COLUMN_INT) {
+            int value = 0;
+            for (char c : text)
+                value = value * 10 + (c - '0');
+            row.number[col.field] = value;
+        }
+        else if constexpr (col.type == COLUMN_DECIMAL) {
+            char buf[32];
+            if (text.empty() || text.size() >= sizeof(buf))
+                return false;
+            text.copy(buf, text.size());
+            buf[text.size()] = '\0';
+            char *stop;
+            row.decimal[col.field] = strtod(buf, &stop);
+            if (*stop != '\0')
+                return false;
+        }
+        else {
+            row.text[col.field] = text;
+        }
+        return parse_columns<Schema, K + 1>(p, end, row);
+    }
+}
+
+} // namespace tree_schema
+
+
+/** parse_tree_row<Schema>(line,row) extracts and validates the columns of
+ *  Schema from one csv line
+ *  @param string_view line [in]  one row of the census file
+ *  @param TreeRow     row  [out] the parsed fields
+ *  @return bool true if every column was present and valid
+ */
+template <class Schema>
+inline bool parse_tree_row(std::string_view line, TreeRow & row) {
+    const char *p = line.data();
+    return tree_schema::parse_columns<Schema>(p, line.data() + line.size(), row);
+}
+
+#endif //TREE_SCHEMA_H
@@ -12,21 +12,6 @@ Modifications: Interface (H) file provided by Professor Weiss
 #include "tree_species.h"
 
 
-// helper function to convert a string to lowercase without hyphens
-string hyphenLower(string s) {
-    string new_str;
-
-    for (int i = 0; i < s.length(); i++) {
-        new_str+=tolower(s[i]);
-    }
-
-    for(int j = 0; j<new_str.length(); j++) {
-        if(new_str[j]=='-')
-            new_str[j] = ' ';
-    }
-
-    return new_str;
-}
 // helper function to convert string to lower
 string turnLower(string s) {
     string new_str;
@@ -72,6 +57,7 @@ TreeSpecies::TreeSpecies(const string & name) {
 // destructor
 TreeSpecies::~TreeSpecies() {
     common.clear();
+    similar.clear();
 }
 
 
@@ -94,21 +80,41 @@ int TreeSpecies::add_species( const string & species) {
         return 0;
     else {
         common.insert(species);
+        similar.insert(species);
         return 1;
     }
 }
 // returns a list of all common names that partially matches the input, case insensitive
 list<string> TreeSpecies::get_matching_species(const string & partial_name) const {
     list<string> species_match;
-    string lower_partial_name = hyphenLower(partial_name);
+    string lower_partial_name = SpeciesDictionary::fold(partial_name);
 
     for (const string &i : common) {
-        if(hyphenLower(i).find(lower_partial_name) != string::npos) {
+        if(SpeciesDictionary::fold(i).find(lower_partial_name) != string::npos) {
                species_match.push_back(turnLower(i));
         }
     }
     return species_match;
+}
 
-
+// returns the lowered names within max_distance edits of name, closest first, each once
+list<string> TreeSpecies::get_similar_species(const string & name, int max_distance) const {
+    vector<SpeciesBkTree::Match> matches;
+    similar.find(name, max_distance, matches);
+    list<string> species_similar;
+    set<string> seen;       // spellings that differ only in case lower to the same name
+    for (const SpeciesBkTree::Match &m : matches) {
+        string lower = turnLower(m.name);
+        if (seen.insert(lower).second)
+            species_similar.push_back(lower);
+    }
+    return species_similar;
 }
 
+// falls back to edit distance only when no name contains the input
+list<string> TreeSpecies::lookup_species(const string & name, int max_distance) const {
+    list<string> species_match = get_matching_species(name);
+    if (species_match.empty())
+        species_match = get_similar_species(name, max_distance);
+    return species_match;
+}
@@ -13,6 +13,7 @@ Modifications:
 #define TREE_SPECIES_H
 #include "__tree_species.h"
 #include "tree_collection.h"
+#include "species_bk_tree.h"
 #include <set>
 #include <fstream>
 #include <sstream>
@@ -61,8 +62,30 @@ public:
      * @return list<string> list of matching species names
      */
     list<string> get_matching_species(const string & partial_name) const override;
+
+    /** get_similar_species(s,k) returns the species whose names are within
+     *                           k edits of s
+     * @note For misspelled names, such as "hony locust" or "london plane
+     * tre". An edit inserts, deletes or changes one character, compared
+     * case insensitively with '-' read as ' '. The names are lower case,
+     * as get_matching_species returns them, closest first; spellings that
+     * lower to the same name give it once.
+     * @param string name         [in] the name to look for
+     * @param int    max_distance [in] the most edits allowed
+     * @return list<string> list of species names, possibly empty
+     */
+    list<string> get_similar_species(const string & name, int max_distance = 2) const;
+
+    /** lookup_species(s,k) returns get_matching_species(s), or, if that is
+     *                      empty, get_similar_species(s,k)
+     * @param string name         [in] the name or partial name to look for
+     * @param int    max_distance [in] the most edits allowed when nothing matches
+     * @return list<string> list of species names, possibly empty
+     */
+    list<string> lookup_species(const string & name, int max_distance = 2) const;
 private:
     set<string> common;     // container containing all species common names
+    SpeciesBkTree similar;  // the same names, by edit distance
 
 };
 
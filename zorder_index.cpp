@@ -0,0 +1,378 @@
+/******************************************************************************
+Title : zorder_index.cpp
+Author : Yu Tong Chen
+Created on : 05/08/2019
+Description : The implementation of zorder_index.
+Usage :
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#include "zorder_index.h"
+#include <algorithm>
+#include <cmath>
+
+static const double KM_PER_DEGREE = 111.2;     // of latitude, anywhere
+
+// default constructor
+ZOrderIndex::ZOrderIndex():stale(0), unsettled(false) {
+}
+
+uint32_t ZOrderIndex::scale(double value, double low, double high) {
+    double t = (value - low) / (high - low);
+    t = (t < 0) ? 0 : (t > 1) ? 1 : t;
+    return (uint32_t)(t * 4294967295.0);
+}
+
+// spreads the bits of x over the even positions and those of y over the odd ones
+uint64_t ZOrderIndex::interleave(uint32_t x, uint32_t y) {
+    uint64_t k = 0;
+    for (int shift = 0; shift < 2; shift++) {
+        uint64_t v = (shift == 0) ? x : y;
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+        v = (v | (v << 8))  & 0x00FF00FF00FF00FFULL;
+        v = (v | (v << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+        v = (v | (v << 2))  & 0x3333333333333333ULL;
+        v = (v | (v << 1))  & 0x5555555555555555ULL;
+        k |= v << shift;
+    }
+    return k;
+}
+
+uint64_t ZOrderIndex::key(double latitude, double longitude) {
+    return interleave(scale(longitude, -180, 180), scale(latitude, -90, 90));
+}
+
+void ZOrderIndex::insert(int slot, double latitude, double longitude) {
+    if (slot >= (int)slot_live.size()) {
+        slot_live.resize(slot + 1, 0);
+        slot_version.resize(slot + 1, 0);
+    }
+    if (slot_live[slot])
+        remove(slot);
+    slot_live[slot] = 1;
+    Entry e = { key(latitude, longitude), latitude, longitude, slot, ++slot_version[slot] };
+    pending.push_back(e);
+    unsettled.store(true, memory_order_relaxed);
+}
+
+void ZOrderIndex::remove(int slot) {
+    if (slot >= (int)slot_live.size() || !slot_live[slot])
+        return;
+    slot_live[slot] = 0;
+    stale++;
+    unsettled.store(true, memory_order_relaxed);
+}
+
+void ZOrderIndex::clear() {
+    entries.clear();
+    pending.clear();
+    stale = 0;
+    slot_live.clear();
+    slot_version.clear();
+    unsettled.store(false, memory_order_relaxed);
+}
+
+/* drops removed entries, then merges the sorted queue into the sorted array; the first query to
+ * find it unsettled does so under settling and the others wait for it
+ */
+void ZOrderIndex::settle() const {
+    if (!unsettled.load(memory_order_acquire))
+        return;
+    lock_guard<mutex> lock(settling);
+    if (!unsettled.load(memory_order_relaxed))
+        return;
+    if (stale > 0) {
+        auto gone = [this](const Entry & e) {
+            return !slot_live[e.slot] || e.version != slot_version[e.slot];
+        };
+        entries.erase(remove_if(entries.begin(), entries.end(), gone), entries.end());
+        pending.erase(remove_if(pending.begin(), pending.end(), gone), pending.end());
+        stale = 0;
+    }
+    auto by_key = [](const Entry & a, const Entry & b) { return a.key < b.key; };
+    sort(pending.begin(), pending.end(), by_key);
+    size_t middle = entries.size();
+    entries.insert(entries.end(), pending.begin(), pending.end());
+    inplace_merge(entries.begin(), entries.begin() + middle, entries.end(), by_key);
+    pending.clear();
+    unsettled.store(false, memory_order_release);
+}
+
+// the index of the first entry whose key is at least key
+size_t ZOrderIndex::first_at(uint64_t key) const {
+    size_t lo = 0, hi = entries.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (entries[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+bool ZOrderIndex::box_cells(double south, double west, double north, double east,
+                            uint32_t & x0, uint32_t & y0, uint32_t & x1, uint32_t & y1) {
+    if (south > north || west > east)
+        return false;
+    x0 = scale(west, -180, 180);
+    x1 = scale(east, -180, 180);
+    y0 = scale(south, -90, 90);
+    y1 = scale(north, -90, 90);
+    return true;
+}
+
+double ZOrderIndex::unscale(uint64_t value, double low, double high) {
+    return low + (high - low) * (value / 4294967295.0);
+}
+
+/* splits the query into key ranges, one quadtree level at a time
+ * classify(xlo,ylo,xhi,yhi) says where a cell lies; a cell inside becomes a range whose trees need no check,
+ * and a boundary cell is split at the next level, unless that could pass max_ranges, in which case it
+ * becomes a boundary range as it is. A level is only split when its cells and the ranges so far fit in
+ * max_ranges, so neither ranges nor cells ever holds more than that
+ */
+template <class Classify>
+int ZOrderIndex::cover(Classify classify, int max_ranges, Range *ranges, uint64_t *cells) const {
+    int count = 0;
+    size_t n = 1;           // cells of the current level, as x prefix << 32 | y prefix
+    cells[0] = 0;
+    for (int level = 0; level <= 32; level++) {
+        int shift = 32 - level;
+        uint64_t width = 1ULL << shift;
+        size_t boundary = 0;
+        for (size_t c = 0; c < n; c++) {
+            uint64_t xlo = (cells[c] >> 32) << shift, ylo = (cells[c] & 0xFFFFFFFFULL) << shift;
+            Overlap overlap = classify(xlo, ylo, xlo + width - 1, ylo + width - 1);
+            if (overlap == INSIDE) {
+                Range r = { interleave(xlo, ylo), interleave(xlo + width - 1, ylo + width - 1), false };
+                ranges[count++] = r;
+            }
+            else if (overlap == BOUNDARY)
+                cells[boundary++] = cells[c];
+        }
+        if (boundary == 0)
+            break;
+        if (level == 32 || count + boundary * 4 > (size_t)max_ranges) {
+            for (size_t c = 0; c < boundary; c++) {
+                uint64_t xlo = (cells[c] >> 32) << shift, ylo = (cells[c] & 0xFFFFFFFFULL) << shift;
+                Range r = { interleave(xlo, ylo), interleave(xlo + width - 1, ylo + width - 1), true };
+                ranges[count++] = r;
+            }
+            break;
+        }
+        n = boundary * 4;
+        for (size_t c = boundary; c-- > 0; ) {     // backwards, so no parent is overwritten before it is split
+            uint64_t x = (cells[c] >> 32) << 1, y = (cells[c] & 0xFFFFFFFFULL) << 1;
+            cells[4 * c]     = (x << 32) | y;
+            cells[4 * c + 1] = ((x + 1) << 32) | y;
+            cells[4 * c + 2] = (x << 32) | (y + 1);
+            cells[4 * c + 3] = ((x + 1) << 32) | (y + 1);
+        }
+    }
+
+    // neighbouring cells often continue each other along the curve
+    sort(ranges, ranges + count, [](const Range & a, const Range & b) {
+        return a.first < b.first;
+    });
+    int merged = 0;
+    for (int r = 0; r < count; r++) {
+        if (merged > 0 && ranges[merged - 1].last + 1 == ranges[r].first
+                && ranges[merged - 1].boundary == ranges[r].boundary)
+            ranges[merged - 1].last = ranges[r].last;
+        else
+            ranges[merged++] = ranges[r];
+    }
+    return merged;
+}
+
+// the box's own edge cells are boundary cells, since they also hold positions just outside it
+int ZOrderIndex::cover_box(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+                           Range *ranges, uint64_t *cells) const {
+    return cover([=](uint64_t xlo, uint64_t ylo, uint64_t xhi, uint64_t yhi) {
+        if (xhi < x0 || xlo > x1 || yhi < y0 || ylo > y1)
+            return OUTSIDE;
+        if (xlo > x0 && xhi < x1 && ylo > y0 && yhi < y1)
+            return INSIDE;
+        return BOUNDARY;
+    }, MAX_RANGES, ranges, cells);
+}
+
+// true if the segment from (ax,ay) to (bx,by) touches the rectangle [x0,x1] x [y0,y1] (Liang-Barsky)
+static bool touches(double ax, double ay, double bx, double by,
+                    double x0, double y0, double x1, double y1) {
+    double t0 = 0, t1 = 1;
+    double p[4] = { -(bx - ax), bx - ax, -(by - ay), by - ay };
+    double q[4] = { ax - x0, x1 - ax, ay - y0, y1 - ay };
+    for (int k = 0; k < 4; k++) {
+        if (p[k] == 0) {
+            if (q[k] < 0)
+                return false;
+        }
+        else {
+            double t = q[k] / p[k];
+            if (p[k] < 0) {
+                if (t > t1)
+                    return false;
+                t0 = max(t0, t);
+            }
+            else {
+                if (t < t0)
+                    return false;
+                t1 = min(t1, t);
+            }
+        }
+    }
+    return true;
+}
+
+/* a cell is on the boundary if an edge touches it; otherwise it is wholly inside or wholly outside,
+ * and its centre says which. The cell's rectangle reaches to the start of the next cell, since scale
+ * rounds every position down, so each tree keyed into the cell lies within it
+ */
+int ZOrderIndex::cover_polygon(const vector<GeoPoint> & polygon, Range *ranges, uint64_t *cells) const {
+    if (polygon.size() < 3)
+        return 0;
+    double south = polygon[0].latitude, north = south;
+    double west = polygon[0].longitude, east = west;
+    for (size_t k = 1; k < polygon.size(); k++) {
+        south = min(south, polygon[k].latitude);
+        north = max(north, polygon[k].latitude);
+        west = min(west, polygon[k].longitude);
+        east = max(east, polygon[k].longitude);
+    }
+    uint32_t x0, y0, x1, y1;
+    if (!box_cells(south, west, north, east, x0, y0, x1, y1))
+        return 0;
+    return cover([&](uint64_t xlo, uint64_t ylo, uint64_t xhi, uint64_t yhi) {
+        if (xhi < x0 || xlo > x1 || yhi < y0 || ylo > y1)
+            return OUTSIDE;
+        double w = unscale(xlo, -180, 180), e = unscale(xhi + 1, -180, 180);
+        double s = unscale(ylo, -90, 90), n = unscale(yhi + 1, -90, 90);
+        for (size_t k = 0, j = polygon.size() - 1; k < polygon.size(); j = k++) {
+            if (touches(polygon[j].longitude, polygon[j].latitude,
+                        polygon[k].longitude, polygon[k].latitude, w, s, e, n))
+                return BOUNDARY;
+        }
+        return contains(polygon, (s + n) / 2, (w + e) / 2) ? INSIDE : OUTSIDE;
+    }, MAX_POLYGON_RANGES, ranges, cells);
+}
+
+// counts the edges crossed by a ray running east from the point
+bool ZOrderIndex::contains(const vector<GeoPoint> & polygon, double latitude, double longitude) {
+    bool inside = false;
+    for (size_t k = 0, j = polygon.size() - 1; k < polygon.size(); j = k++) {
+        const GeoPoint & a = polygon[k];
+        const GeoPoint & b = polygon[j];
+        if ((a.latitude > latitude) != (b.latitude > latitude)
+                && longitude < (b.longitude - a.longitude) * (latitude - a.latitude)
+                               / (b.latitude - a.latitude) + a.longitude)
+            inside = !inside;
+    }
+    return inside;
+}
+
+void ZOrderIndex::in_box(double south, double west, double north, double east,
+                         vector<int> & out) const {
+    out.clear();
+    for_each_in_box(south, west, north, east, [&out](int slot, double, double) {
+        out.push_back(slot);
+    });
+}
+
+void ZOrderIndex::in_polygon(const vector<GeoPoint> & polygon, vector<int> & out) const {
+    out.clear();
+    for_each_in_polygon(polygon, [&out](int slot, double, double) {
+        out.push_back(slot);
+    });
+}
+
+// the box around the circle of distance km about (lat,lon)
+static void circle_box(double lat, double lon, double distance,
+                       double & south, double & west, double & north, double & east) {
+    double dlat = distance / KM_PER_DEGREE;
+    double c = cos(lat * M_PI / 180.0);
+    double dlon = (c > 1e-6) ? distance / (KM_PER_DEGREE * c) : 360;
+    south = lat - dlat;
+    north = lat + dlat;
+    west = lon - dlon;
+    east = lon + dlon;
+}
+
+// the circle's bounding box is searched first; only the trees inside it are passed to haversine
+void ZOrderIndex::near(double latitude, double longitude, double distance,
+                       vector<int> & out) const {
+    out.clear();
+    if (distance < 0)
+        return;
+    double south, west, north, east;
+    circle_box(latitude, longitude, distance, south, west, north, east);
+    for_each_in_box(south, west, north, east, [&](int slot, double lat, double lon) {
+        if (haversine(lat, lon, latitude, longitude) <= distance)
+            out.push_back(slot);
+    });
+}
+
+uint64_t ZOrderIndex::grid_cell(const QueryGrid & grid, double latitude, double longitude) {
+    uint64_t row = (uint64_t)((latitude - grid.south) / grid.height);
+    uint64_t column = (uint64_t)((longitude - grid.west) / grid.width);
+    return row * grid.columns + column;
+}
+
+/* cells are a quarter of the largest query box across, so a tree meets few queries whose box misses it,
+ * while no query is entered in more than 36 cells; the queries are sorted by cell, and cells maps each
+ * cell to its run of members
+ */
+bool ZOrderIndex::build_grid(const NearQuery *queries, int count, QueryGrid & grid) const {
+    double height = 0, width = 0;
+    bool any = false;
+    for (int q = 0; q < count; q++) {
+        if (queries[q].distance < 0)
+            continue;
+        double s, w, n, e;
+        circle_box(queries[q].latitude, queries[q].longitude, queries[q].distance, s, w, n, e);
+        if (!any) {
+            grid.south = s; grid.west = w; grid.north = n; grid.east = e;
+            any = true;
+        }
+        grid.south = min(grid.south, s);
+        grid.west = min(grid.west, w);
+        grid.north = max(grid.north, n);
+        grid.east = max(grid.east, e);
+        height = max(height, n - s);
+        width = max(width, e - w);
+    }
+    if (!any)
+        return false;
+    grid.height = max(height / 4, 1e-6);
+    grid.width = max(width / 4, 1e-6);
+    grid.columns = (uint64_t)((grid.east - grid.west) / grid.width) + 1;
+
+    for (int q = 0; q < count; q++) {
+        if (queries[q].distance < 0)
+            continue;
+        double s, w, n, e;
+        circle_box(queries[q].latitude, queries[q].longitude, queries[q].distance, s, w, n, e);
+        uint64_t first = grid_cell(grid, s, w), last = grid_cell(grid, n, e);
+        uint64_t c0 = first % grid.columns, c1 = last % grid.columns;
+        for (uint64_t row = first / grid.columns; row <= last / grid.columns; row++)
+            for (uint64_t column = c0; column <= c1; column++)
+                grid.entered.push_back(make_pair(row * grid.columns + column, q));
+    }
+    sort(grid.entered.begin(), grid.entered.end());
+    grid.members.resize(grid.entered.size());
+    size_t start = 0;
+    for (size_t k = 0; k < grid.entered.size(); k++) {
+        Member & m = grid.members[k];
+        m.query = grid.entered[k].second;
+        const NearQuery & q = queries[m.query];
+        circle_box(q.latitude, q.longitude, q.distance, m.south, m.west, m.north, m.east);
+        if (k + 1 == grid.entered.size() || grid.entered[k + 1].first != grid.entered[k].first) {
+            grid.cells[grid.entered[k].first] = make_pair((int)start, (int)k + 1);
+            start = k + 1;
+        }
+    }
+    return true;
+}
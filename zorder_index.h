@@ -0,0 +1,262 @@
+/******************************************************************************
+Title : zorder_index.h
+Author : Yu Tong Chen
+Created on : 05/08/2019
+Description : The interface of ZOrderIndex, a copy of every tree's position
+              sorted along a Z-order (Morton) curve.
+Usage : Maintained by TreeCollection::add_tree and remove_tree; the
+        spatial queries of TreeCollection read it through near, in_box and
+        in_polygon.
+Build with : Makefile
+Modifications:
+
+******************************************************************************/
+
+#ifndef ZORDER_INDEX_H
+#define ZORDER_INDEX_H
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+using namespace std;
+
+double haversine(double lat1, double lon1, double lat2, double lon2);  // tree_collection.cpp
+
+// a corner of a polygon given to ZOrderIndex::in_polygon
+struct GeoPoint {
+    double latitude;
+    double longitude;
+};
+
+// one circle of a batch given to ZOrderIndex::join_near
+struct NearQuery {
+    double latitude;
+    double longitude;
+    double distance;     // in kilometers
+};
+
+/** class ZOrderIndex
+ *  Latitude and longitude are each scaled to 32 bits and their bits are
+ *  interleaved into one 64-bit key, so trees that are close on the map are
+ *  usually close in the array. A box is covered by a few aligned quadtree
+ *  cells, and each cell is one contiguous run of keys. A query therefore
+ *  binary searches for a handful of runs and reads each one sequentially.
+ *  Cells outside the box are never read at all, and the trees of a cell
+ *  wholly inside it are taken without a check. Polygons are covered the
+ *  same way, with more, smaller cells along their edges.
+ *
+ *  Changes are queued and merged into the sorted array by the next query,
+ *  so loading n trees costs one sort instead of n shifted inserts.
+ */
+class ZOrderIndex {
+    public:
+        // the most key ranges a box is split into; more means fewer trees read
+        static const int MAX_RANGES = 16;
+
+        // the same for a polygon, which has to be followed more closely
+        static const int MAX_POLYGON_RANGES = 256;
+
+        ZOrderIndex();
+
+        /** insert(slot,lat,lng) adds the tree at slot, at position (lat,lng) */
+        void insert(int slot, double latitude, double longitude);
+
+        /** remove(slot) removes the tree at slot, if it is indexed */
+        void remove(int slot);
+
+        void clear();
+
+        /** near(lat,lng,dist,out) puts the slots of the trees within dist km
+         *                         of (lat,lng) into out, after clearing it
+         * @notes Only trees inside the bounding box of the circle are passed
+         *        to haversine.
+         */
+        void near(double latitude, double longitude, double distance,
+                  vector<int> & out) const;
+
+        /** in_box(s,w,n,e,out) puts the slots of the trees with s <= latitude
+         *                      <= n and w <= longitude <= e into out, after
+         *                      clearing it
+         */
+        void in_box(double south, double west, double north, double east,
+                    vector<int> & out) const;
+
+        /** in_polygon(p,out) puts the slots of the trees inside polygon p into
+         *                   out, after clearing it
+         * @notes
+         *       The corners of p are given in order, either way round; the
+         *       last one joins back to the first. Only the trees in cells
+         *       that an edge of p passes through are tested against p.
+         */
+        void in_polygon(const vector<GeoPoint> & polygon, vector<int> & out) const;
+
+        /** for_each_in_box(s,w,n,e,visit) calls visit(slot,lat,lng) for every
+         *                                 tree in the box, in key order
+         */
+        template <class Visit>
+        void for_each_in_box(double south, double west, double north, double east,
+                             Visit visit) const {
+            settle();
+            uint32_t x0, y0, x1, y1;
+            if (!box_cells(south, west, north, east, x0, y0, x1, y1))
+                return;
+            Range    ranges[MAX_RANGES];
+            uint64_t cells[MAX_RANGES];
+            int count = cover_box(x0, y0, x1, y1, ranges, cells);
+            for (int r = 0; r < count; r++) {
+                size_t i = first_at(ranges[r].first);
+                for (; i < entries.size() && entries[i].key <= ranges[r].last; i++) {
+                    const Entry & e = entries[i];
+                    if (!ranges[r].boundary || (e.latitude >= south && e.latitude <= north
+                            && e.longitude >= west && e.longitude <= east))
+                        visit(e.slot, e.latitude, e.longitude);
+                }
+            }
+        }
+
+        /** for_each_in_polygon(p,visit) calls visit(slot,lat,lng) for every
+         *                               tree inside polygon p, in key order
+         */
+        template <class Visit>
+        void for_each_in_polygon(const vector<GeoPoint> & polygon, Visit visit) const {
+            settle();
+            Range    ranges[MAX_POLYGON_RANGES];
+            uint64_t cells[MAX_POLYGON_RANGES];
+            int count = cover_polygon(polygon, ranges, cells);
+            for (int r = 0; r < count; r++) {
+                size_t i = first_at(ranges[r].first);
+                for (; i < entries.size() && entries[i].key <= ranges[r].last; i++) {
+                    const Entry & e = entries[i];
+                    if (!ranges[r].boundary || contains(polygon, e.latitude, e.longitude))
+                        visit(e.slot, e.latitude, e.longitude);
+                }
+            }
+        }
+
+        /** join_near(q,n,visit) calls visit(i,slot) for every tree within
+         *                      q[i].distance km of query i, for each of the n
+         *                      queries q[0..n-1]
+         * @notes
+         *       This is one pass over the trees, however many queries there
+         *       are. Each query is entered in the cells of a grid that its
+         *       bounding box overlaps, and each tree is only compared with
+         *       the queries entered in its own cell, and passed to haversine
+         *       for those whose box holds it. Cells are a quarter of the
+         *       largest query box across, so a few very wide circles make
+         *       every tree meet more queries.
+         */
+        template <class Visit>
+        void join_near(const NearQuery *queries, int count, Visit visit) const {
+            settle();
+            QueryGrid grid;
+            if (!build_grid(queries, count, grid))
+                return;
+            pair<int, int> run(0, 0);
+            uint64_t run_cell = UINT64_MAX;
+            for (size_t i = 0; i < entries.size(); i++) {
+                const Entry & e = entries[i];
+                if (e.latitude < grid.south || e.latitude > grid.north
+                        || e.longitude < grid.west || e.longitude > grid.east)
+                    continue;
+                uint64_t cell = grid_cell(grid, e.latitude, e.longitude);
+                if (cell != run_cell) {     // neighbours on the curve are mostly in the same cell
+                    unordered_map<uint64_t, pair<int, int> >::const_iterator it = grid.cells.find(cell);
+                    run = (it == grid.cells.end()) ? make_pair(0, 0) : it->second;
+                    run_cell = cell;
+                }
+                for (int k = run.first; k < run.second; k++) {
+                    const Member & m = grid.members[k];
+                    if (e.latitude < m.south || e.latitude > m.north
+                            || e.longitude < m.west || e.longitude > m.east)
+                        continue;
+                    const NearQuery & q = queries[m.query];
+                    if (haversine(e.latitude, e.longitude, q.latitude, q.longitude) <= q.distance)
+                        visit(m.query, e.slot);
+                }
+            }
+        }
+
+        /** contains(p,lat,lng) returns true if (lat,lng) is inside polygon p,
+         *                      by the even-odd rule
+         */
+        static bool contains(const vector<GeoPoint> & polygon,
+                             double latitude, double longitude);
+
+        /** key(lat,lng) returns the Z-order key of a position */
+        static uint64_t key(double latitude, double longitude);
+
+    private:
+        struct Entry {
+            uint64_t key;
+            double   latitude;
+            double   longitude;
+            int      slot;
+            unsigned version;    // stale once slot_version[slot] moves on
+        };
+
+        mutable vector<Entry>      entries;    // sorted by key, once settled
+        mutable vector<Entry>      pending;    // inserted since the last query
+        mutable int                stale;      // entries whose tree was removed
+        vector<unsigned>           slot_version;
+        vector<unsigned char>      slot_live;
+
+        // the keys of one cell, or of a run of cells; only the trees of a
+        // boundary range need to be checked against the query
+        struct Range {
+            uint64_t first;
+            uint64_t last;
+            bool     boundary;
+        };
+
+        // how a cell lies against the query being covered
+        enum Overlap { OUTSIDE, INSIDE, BOUNDARY };
+
+        // a query of a join_near entered in a grid cell, with its box
+        struct Member {
+            double south, west, north, east;
+            int    query;
+        };
+
+        // the queries of a join_near, by the grid cells their boxes overlap
+        struct QueryGrid {
+            double   south, west, north, east;   // a box around every query
+            double   height, width;              // of one cell, in degrees
+            uint64_t columns;
+            unordered_map<uint64_t, pair<int, int> > cells;  // cell -> its run of members
+            vector<Member>                  members;         // by cell
+            vector<pair<uint64_t, int> >    entered;         // (cell, query), while building
+        };
+
+        // A query first merges the queued changes, so entries, pending and
+        // stale change under const methods. settle does so holding settling
+        // and clears unsettled only when done, as AvlTree's does, and every
+        // query keeps its ranges and grid to itself, so const queries are
+        // safe to run at once, but not alongside insert, remove or clear.
+        mutable atomic<bool>       unsettled;  // true while pending or stale is not empty
+        mutable mutex              settling;
+
+        void   settle() const;
+        // the covers write at most max_ranges ranges, using as many cells
+        // as scratch, and return how many they wrote
+        template <class Classify>
+        int    cover(Classify classify, int max_ranges, Range *ranges, uint64_t *cells) const;
+        int    cover_box(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+                         Range *ranges, uint64_t *cells) const;
+        int    cover_polygon(const vector<GeoPoint> & polygon, Range *ranges, uint64_t *cells) const;
+        bool   build_grid(const NearQuery *queries, int count, QueryGrid & grid) const;
+        static uint64_t grid_cell(const QueryGrid & grid, double latitude, double longitude);
+        size_t first_at(uint64_t key) const;
+        static bool box_cells(double south, double west, double north, double east,
+                              uint32_t & x0, uint32_t & y0, uint32_t & x1, uint32_t & y1);
+        static uint32_t scale(double value, double low, double high);
+        static double   unscale(uint64_t value, double low, double high);
+        static uint64_t interleave(uint32_t x, uint32_t y);
+};
+
+
+#endif //ZORDER_INDEX_H